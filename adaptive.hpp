@@ -0,0 +1,220 @@
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include <glm/glm.hpp>
+#include "integrators.hpp"
+
+// Adaptive step size on top of integrators.hpp. An embedded tableau carries
+// two weight rows: b advances the state and bhat gives a lower order
+// solution whose difference from it estimates the local error. The step is
+// accepted when that error is within atol + rtol*|y| for every component of
+// position and velocity, and a PI controller picks the next step size.
+// Between the last two accepted states the solution is available through
+// cubic Hermite interpolation (dense output), so output at fixed times does
+// not force small steps.
+//
+// The state is kept in float, so tolerances much below 1e-6 only add steps.
+
+// Dormand-Prince 5(4); the last stage is the new state (first same as last)
+struct DormandPrince54Tableau
+{
+    static constexpr int stages = 7;
+    static constexpr int errorOrder = 4;
+    static constexpr bool fsal = true;
+    static constexpr double a[7][7] = {
+        { 0, 0, 0, 0, 0, 0, 0 },
+        { 1.0/5, 0, 0, 0, 0, 0, 0 },
+        { 3.0/40, 9.0/40, 0, 0, 0, 0, 0 },
+        { 44.0/45, -56.0/15, 32.0/9, 0, 0, 0, 0 },
+        { 19372.0/6561, -25360.0/2187, 64448.0/6561, -212.0/729, 0, 0, 0 },
+        { 9017.0/3168, -355.0/33, 46732.0/5247, 49.0/176, -5103.0/18656, 0, 0 },
+        { 35.0/384, 0, 500.0/1113, 125.0/192, -2187.0/6784, 11.0/84, 0 }
+    };
+    static constexpr double b[7] = { 35.0/384, 0, 500.0/1113, 125.0/192, -2187.0/6784, 11.0/84, 0 };
+    static constexpr double bhat[7] = { 5179.0/57600, 0, 7571.0/16695, 393.0/640, -92097.0/339200, 187.0/2100, 1.0/40 };
+};
+
+// Bogacki-Shampine 3(2), also first same as last
+struct BogackiShampine32Tableau
+{
+    static constexpr int stages = 4;
+    static constexpr int errorOrder = 2;
+    static constexpr bool fsal = true;
+    static constexpr double a[4][4] = {
+        { 0, 0, 0, 0 },
+        { 1.0/2, 0, 0, 0 },
+        { 0, 3.0/4, 0, 0 },
+        { 2.0/9, 1.0/3, 4.0/9, 0 }
+    };
+    static constexpr double b[4] = { 2.0/9, 1.0/3, 4.0/9, 0 };
+    static constexpr double bhat[4] = { 7.0/24, 1.0/4, 1.0/3, 1.0/8 };
+};
+
+// largest |err| / (atol + rtol*max(|y0|, |y1|)) over the components
+inline float errorRatio(float err, float y0, float y1, float atol, float rtol)
+{
+    return std::fabs(err) / (atol + rtol * std::max(std::fabs(y0), std::fabs(y1)));
+}
+
+inline float errorRatio(const glm::vec3 &err, const glm::vec3 &y0, const glm::vec3 &y1, float atol, float rtol)
+{
+    return std::max(errorRatio(err.x, y0.x, y1.x, atol, rtol),
+           std::max(errorRatio(err.y, y0.y, y1.y, atol, rtol),
+                    errorRatio(err.z, y0.z, y1.z, atol, rtol)));
+}
+
+namespace integrators_detail
+{
+    template<typename T, int J, typename Vec>
+    inline void embeddedTerm(const Vec *kx, const Vec *kv, float dt,
+                             Vec &dx, Vec &dv, Vec &ex, Vec &ev)
+    {
+        if constexpr (T::b[J] != 0) {
+            const float h = float(T::b[J]) * dt;
+            dx = dx + kx[J] * h;
+            dv = dv + kv[J] * h;
+        }
+        if constexpr (T::b[J] - T::bhat[J] != 0) {
+            const float h = float(T::b[J] - T::bhat[J]) * dt;
+            ex = ex + kx[J] * h;
+            ev = ev + kv[J] * h;
+        }
+    }
+
+    // one trial step from s into out; returns the scaled error estimate and
+    // the number of force evaluations used
+    template<typename T, typename Vec, typename Force, std::size_t... I>
+    inline float embeddedStep(const PhaseState<Vec> &s, PhaseState<Vec> &out, float dt,
+                              const Force &force, float atol, float rtol, int &evaluations,
+                              std::index_sequence<I...>)
+    {
+        Vec kx[T::stages];
+        Vec kv[T::stages];
+        (stage<T, int(I)>(s, kx, kv, dt, force, std::make_index_sequence<I>()), ...);
+        Vec dx = s.x * 0.0f, dv = s.v * 0.0f, ex = s.x * 0.0f, ev = s.v * 0.0f;
+        (embeddedTerm<T, int(I)>(kx, kv, dt, dx, dv, ex, ev), ...);
+        out.x = s.x + dx;
+        out.v = s.v + dv;
+        if constexpr (T::fsal) {
+            out.a = kv[T::stages - 1];
+            evaluations = T::stages - 1;
+        } else {
+            out.a = force(out.x, out.v);
+            evaluations = T::stages;
+        }
+        return std::max(errorRatio(ex, s.x, out.x, atol, rtol), errorRatio(ev, s.v, out.v, atol, rtol));
+    }
+}
+
+// Integrates one state with tableau T under force f. step() takes one
+// accepted step, advanceTo() stops exactly on a given time.
+template<typename T, typename Vec, typename Force>
+class AdaptiveIntegrator
+{
+public:
+    AdaptiveIntegrator()
+    {
+        time = previousTime = 0.0;
+        h = 1e-3f;
+        hMin = 1e-7f;
+        rtol = 1e-6f;
+        atol = 1e-6f;
+        lastError = 1.0f;
+        accepted = rejected = evaluations = 0;
+    }
+
+    // s.a must be force(s.x, s.v)
+    void init(const PhaseState<Vec> &s, double t0, const Force &f,
+              float relTol = 1e-6f, float absTol = 1e-6f, float h0 = 1e-3f)
+    {
+        state = previous = s;
+        time = previousTime = t0;
+        force = f;
+        rtol = relTol;
+        atol = absTol;
+        h = h0;
+        lastError = 1.0f;
+        accepted = rejected = evaluations = 0;
+    }
+
+    // takes one accepted step no longer than hMax and returns its size
+    float step(float hMax)
+    {
+        const float safety = 0.9f;
+        const float exponent = 1.0f / (T::errorOrder + 1);
+        PhaseState<Vec> trial;
+        for (;;) {
+            float dt = std::min(h, hMax);
+            int used = 0;
+            float err = integrators_detail::embeddedStep<T>(state, trial, dt, force, atol, rtol, used,
+                                                            std::make_index_sequence<T::stages>());
+            evaluations += used;
+            if (err <= 1.0f || dt <= hMin) {
+                // PI controller: the previous error damps oscillating step sizes
+                float factor = err > 0.0f
+                    ? safety * std::pow(err, -0.7f * exponent) * std::pow(lastError, 0.4f * exponent)
+                    : 5.0f;
+                factor = std::min(5.0f, std::max(0.2f, factor));
+                if (dt == h || factor < 1.0f) {
+                    h = dt * factor;
+                }
+                lastError = std::max(err, 1e-4f);
+                previous = state;
+                previousTime = time;
+                state = trial;
+                time += dt;
+                accepted++;
+                return dt;
+            }
+            h = std::max(hMin, dt * std::max(0.2f, safety * std::pow(err, -exponent)));
+            rejected++;
+        }
+    }
+
+    // steps until the time reaches t, shortening the last step to land on it
+    void advanceTo(double t)
+    {
+        while (time < t) {
+            step(float(t - time));
+        }
+    }
+
+    // state at a time between the last two accepted steps
+    void interpolate(double t, Vec &x, Vec &v) const
+    {
+        float dt = float(time - previousTime);
+        if (dt <= 0.0f) {
+            x = state.x;
+            v = state.v;
+            return;
+        }
+        float u = float((t - previousTime) / dt);
+        float u2 = u * u, u3 = u2 * u;
+        float h00 = 2 * u3 - 3 * u2 + 1, h10 = u3 - 2 * u2 + u;
+        float h01 = -2 * u3 + 3 * u2, h11 = u3 - u2;
+        x = previous.x * h00 + previous.v * (h10 * dt) + state.x * h01 + state.v * (h11 * dt);
+        v = previous.v * h00 + previous.a * (h10 * dt) + state.v * h01 + state.a * (h11 * dt);
+    }
+
+    const PhaseState<Vec> &getState() const { return state; }
+    double getTime() const { return time; }
+    double getPreviousTime() const { return previousTime; }
+    float getStepSize() const { return h; }
+    void setMinStepSize(float minStep) { hMin = minStep; }
+    long long getAccepted() const { return accepted; }
+    long long getRejected() const { return rejected; }
+    long long getEvaluations() const { return evaluations; }
+
+private:
+    PhaseState<Vec> state, previous;
+    double time, previousTime;
+    Force force;
+    float h, hMin, rtol, atol;
+    float lastError;
+    long long accepted, rejected, evaluations;
+};
+
+#endif // ADAPTIVE_H
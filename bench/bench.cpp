@@ -0,0 +1,315 @@
+// Microbenchmarks for the physics and mesh-generation hot paths. Each case
+// is calibrated to run for at least --min-time seconds per repetition and
+// reports the median of --reps repetitions as ns per operation and
+// operations per second, plus heap allocations per operation (counted by
+// replacing the global operator new). Results also go to a JSON file so
+// runs can be diffed between releases.
+//
+// An operation is one body (or one pendulum, or one pair) for the per-body
+// cases, so ns/op stays comparable across sizes; mesh cases build one mesh.
+//
+// usage: bench [--json file] [--min-time seconds] [--reps n] [--max n] [--filter text]
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "../physics.hpp"
+#include "../ensemble.hpp"
+#include "../mesh.hpp"
+#include "../container.hpp"
+#include "../simd.hpp"
+
+static std::atomic<unsigned long long> allocCount(0);
+static std::atomic<unsigned long long> allocBytes(0);
+
+static void *countedAlloc(std::size_t n) {
+	allocCount++;
+	allocBytes += n;
+	void *p = malloc(n ? n : 1);
+	if (!p){
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+static void *countedAlignedAlloc(std::size_t n, std::size_t align) {
+	allocCount++;
+	allocBytes += n;
+	std::size_t size = (n + align - 1) / align * align;
+#ifdef _WIN32
+	void *p = _aligned_malloc(size ? size : align, align);
+#else
+	void *p = aligned_alloc(align, size ? size : align);
+#endif
+	if (!p){
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+static void alignedFree(void *p) {
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+void *operator new(std::size_t n) { return countedAlloc(n); }
+void *operator new[](std::size_t n) { return countedAlloc(n); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, std::size_t) noexcept { free(p); }
+void operator delete[](void *p, std::size_t) noexcept { free(p); }
+void *operator new(std::size_t n, std::align_val_t a) { return countedAlignedAlloc(n, (std::size_t)a); }
+void *operator new[](std::size_t n, std::align_val_t a) { return countedAlignedAlloc(n, (std::size_t)a); }
+void operator delete(void *p, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { alignedFree(p); }
+
+struct Result
+{
+	std::string name;
+	int size;
+	double nsPerOp;
+	double opsPerSecond;
+	double allocsPerOp;
+	double bytesPerOp;
+};
+
+static double minTime = 0.2;
+static int reps = 5;
+static const char *filter = 0;
+static std::vector<Result> results;
+
+static double seconds(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+	return std::chrono::duration_cast<std::chrono::duration<double>>(b - a).count();
+}
+
+// fn performs opsPerCall operations; it is called enough times to fill minTime
+template<typename Fn>
+static void measure(const char *name, int size, long long opsPerCall, Fn fn) {
+	if (filter && !strstr(name, filter)){
+		return;
+	}
+	fn();
+	long long calls = 1;
+	for (;;){
+		auto t0 = std::chrono::steady_clock::now();
+		for (long long c = 0; c < calls; ++c){
+			fn();
+		}
+		double s = seconds(t0, std::chrono::steady_clock::now());
+		if (s >= minTime/10 || calls >= (1LL << 40)){
+			calls = std::max(1LL, (long long)(calls * minTime / std::max(s, 1e-9)));
+			break;
+		}
+		calls *= 4;
+	}
+
+	// reserved up front so the only allocations counted are fn's
+	std::vector<double> samples;
+	samples.reserve(reps);
+	unsigned long long allocs0 = allocCount, bytes0 = allocBytes;
+	for (int r = 0; r < reps; ++r){
+		auto t0 = std::chrono::steady_clock::now();
+		for (long long c = 0; c < calls; ++c){
+			fn();
+		}
+		samples.push_back(seconds(t0, std::chrono::steady_clock::now()) * 1e9 / ((double)calls * opsPerCall));
+	}
+	// read before building the Result, whose name may allocate
+	unsigned long long allocs = allocCount - allocs0, bytes = allocBytes - bytes0;
+	std::sort(samples.begin(), samples.end());
+	double totalOps = (double)calls * opsPerCall * reps;
+
+	Result res;
+	res.name = name;
+	res.size = size;
+	res.nsPerOp = samples[samples.size()/2];
+	res.opsPerSecond = 1e9 / res.nsPerOp;
+	res.allocsPerOp = allocs / totalOps;
+	res.bytesPerOp = bytes / totalOps;
+	results.push_back(res);
+	printf("%-28s %8d %12.2f %14.4g %12.3f %12.1f\n", name, size, res.nsPerOp, res.opsPerSecond, res.allocsPerOp, res.bytesPerOp);
+	fflush(stdout);
+}
+
+// n pendulums at angles spread over +-60 degrees, swinging
+static void makePendulums(std::vector<Body> &bodies, int n) {
+	bodies.assign(n, Body());
+	for (int i = 0; i < n; ++i){
+		float theta = glm::radians(-60.0f + 120.0f*(i + 0.5f)/n);
+		initPendulum(bodies[i], theta);
+	}
+}
+
+static void benchBodies(int n) {
+	std::vector<Body> bodies;
+	const float dt = 0.001f;
+
+	makePendulums(bodies, n);
+	measure("updateAcceleration", n, n, [&]{ for (Body &b : bodies) updateAcceleration(b); });
+	makePendulums(bodies, n);
+	measure("IntegrateEuler", n, n, [&]{ for (Body &b : bodies) IntegrateEuler(b, dt); });
+	makePendulums(bodies, n);
+	measure("IntegrateRK4", n, n, [&]{ for (Body &b : bodies) IntegrateRK4(b, dt); });
+	makePendulums(bodies, n);
+	measure("IntegrateVerlet", n, n, [&]{ for (Body &b : bodies) IntegrateVerlet(b, dt); });
+
+	// free bodies scattered over and past the walls, so every branch is taken
+	bodies.assign(n, Body());
+	for (int i = 0; i < n; ++i){
+		float f = (i + 0.5f)/n;
+		bodies[i].setPosition(glm::vec3(-3.0f + 6.0f*f, 3.0f - 6.0f*f, -0.5f + 4.0f*f));
+		bodies[i].setVelocity(glm::vec3(1.0f, -1.0f, -1.0f));
+	}
+	std::vector<Body> start = bodies;
+	measure("CheckBC", n, n, [&]{ bodies = start; for (Body &b : bodies) CheckBC(b); });
+	BodyArrays arrays, startArrays;
+	startArrays.load(start);
+	arrays.init(n);
+	const int bytes = startArrays.paddedSize() * sizeof(float);
+	measure("Container::collide arrays", n, n, [&]{
+		memcpy(arrays.x, startArrays.x, bytes);
+		memcpy(arrays.y, startArrays.y, bytes);
+		memcpy(arrays.z, startArrays.z, bytes);
+		memcpy(arrays.vx, startArrays.vx, bytes);
+		memcpy(arrays.vy, startArrays.vy, bytes);
+		memcpy(arrays.vz, startArrays.vz, bytes);
+		defaultContainer().collide(arrays, R);
+	});
+
+	// overlapping pairs approaching each other
+	std::vector<Body> pairs(2*n);
+	for (int i = 0; i < n; ++i){
+		pairs[2*i].setPosition(glm::vec3(0.0f, 0.0f, 1.0f));
+		pairs[2*i].setVelocity(glm::vec3(1.0f, 0.0f, 0.0f));
+		pairs[2*i+1].setPosition(glm::vec3(0.9f*R, 0.1f, 1.0f));
+		pairs[2*i+1].setVelocity(glm::vec3(-1.0f, 0.0f, 0.0f));
+	}
+	measure("SphereCollision", n, n, [&]{ for (int i = 0; i < n; ++i) SphereCollision(pairs[2*i], pairs[2*i+1]); });
+}
+
+static void benchEnsemble(int n) {
+	Ensemble ensemble;
+	ensemble.init(n, puntofijo, gravity);
+	for (int i = 0; i < n; ++i){
+		ensemble.setPendulum(i, glm::radians(-60.0f + 120.0f*(i + 0.5f)/n), 0.0f, L, 1.0f);
+	}
+	const float dt = 0.001f;
+	measure("Ensemble::IntegrateVerlet", n, n, [&]{ ensemble.IntegrateVerlet(dt); });
+	measure("Ensemble::IntegrateRK4", n, n, [&]{ ensemble.IntegrateRK4(dt); });
+	measure("Ensemble::IntegrateAngleRK4", n, n, [&]{ ensemble.IntegrateAngleRK4(dt); });
+	ensemble.cleanup();
+}
+
+static void benchMeshes() {
+	// fresh vectors each time, as Sphere and Plane build them
+	measure("buildSphereMesh 36x18", 1, 1, []{
+		std::vector<float> v;
+		std::vector<unsigned int> i;
+		buildSphereMesh(R, 36, 18, v, i);
+	});
+	measure("buildSphereMesh 8x4", 1, 1, []{
+		std::vector<float> v;
+		std::vector<unsigned int> i;
+		buildSphereMesh(R, 8, 4, v, i);
+	});
+	measure("buildPlaneMesh 2x2", 1, 1, []{
+		std::vector<float> v;
+		std::vector<unsigned int> i;
+		buildPlaneMesh(0.0f, 2, 2, v, i);
+	});
+}
+
+static std::string jsonEscape(const std::string &s) {
+	std::string out;
+	for (char c : s){
+		if (c == '"' || c == '\\'){
+			out += '\\';
+		}
+		out += c;
+	}
+	return out;
+}
+
+static bool writeJson(const char *path) {
+	std::ofstream file(path);
+	if (!file){
+		return false;
+	}
+	char line[512];
+	file << "{\n";
+	file << "  \"simd\": \"" << SIMD_NAME << "\",\n";
+	file << "  \"fast_trig\": " << (getFastTrig() ? "true" : "false") << ",\n";
+#ifdef __VERSION__
+	file << "  \"compiler\": \"" << jsonEscape(__VERSION__) << "\",\n";
+#endif
+	file << "  \"min_time\": " << minTime << ",\n";
+	file << "  \"reps\": " << reps << ",\n";
+	file << "  \"results\": [\n";
+	for (size_t k = 0; k < results.size(); ++k){
+		const Result &r = results[k];
+		snprintf(line, sizeof(line),
+			"    { \"name\": \"%s\", \"size\": %d, \"ns_per_op\": %.4f, \"ops_per_s\": %.6g, \"allocs_per_op\": %.6g, \"bytes_per_op\": %.6g }%s\n",
+			jsonEscape(r.name).c_str(), r.size, r.nsPerOp, r.opsPerSecond, r.allocsPerOp, r.bytesPerOp,
+			k + 1 < results.size() ? "," : "");
+		file << line;
+	}
+	file << "  ]\n}\n";
+	return true;
+}
+
+int main(int argc, char **argv) {
+	const char *jsonPath = "bench.json";
+	int maxSize = 65536;
+	for (int i = 1; i < argc; ++i){
+		if (strcmp(argv[i],"--json") == 0 && i+1 < argc){
+			jsonPath = argv[++i];
+		} else if (strcmp(argv[i],"--min-time") == 0 && i+1 < argc){
+			minTime = atof(argv[++i]);
+		} else if (strcmp(argv[i],"--reps") == 0 && i+1 < argc){
+			reps = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--max") == 0 && i+1 < argc){
+			maxSize = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--filter") == 0 && i+1 < argc){
+			filter = argv[++i];
+		} else if (strcmp(argv[i],"--fast-trig") == 0){
+			setFastTrig(true);
+		} else {
+			std::cerr << "usage: " << argv[0] << " [--json file] [--min-time seconds] [--reps n] [--max n] [--filter text] [--fast-trig]" << std::endl;
+			return 1;
+		}
+	}
+	if (minTime <= 0.0 || reps <= 0 || maxSize <= 0){
+		std::cerr << "--min-time, --reps and --max must be positive" << std::endl;
+		return 1;
+	}
+
+	printf("simd: %s  fast trig: %s\n", SIMD_NAME, getFastTrig() ? "on" : "off");
+	printf("%-28s %8s %12s %14s %12s %12s\n", "case", "size", "ns/op", "ops/s", "allocs/op", "bytes/op");
+	for (int n = 1; n <= maxSize; n *= 16){
+		benchBodies(n);
+	}
+	for (int n = 16; n <= maxSize; n *= 16){
+		benchEnsemble(n);
+	}
+	benchMeshes();
+
+	if (!writeJson(jsonPath)){
+		std::cerr << "cannot write " << jsonPath << std::endl;
+		return 1;
+	}
+	std::cout << "results written to " << jsonPath << std::endl;
+	return 0;
+}
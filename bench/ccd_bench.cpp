@@ -0,0 +1,167 @@
+// Compares discrete collision handling (move, then Container::collide and
+// CollideAll on the overlaps at the end of the step) with ContinuousStepper
+// at growing timesteps.
+//
+// Head-on: pairs of spheres fired at each other along x at 10 to 40 m/s
+// relative speed, no gravity. A pair that ends the run in swapped order went
+// through each other instead of bouncing.
+//
+// Gas: spheres falling and bouncing in the CheckBC box, every wall and pair
+// contact elastic. Reports the wall-clock time per simulated second and the
+// drift of the total energy after one simulated second.
+//
+// usage: ccd_bench [--spheres n] [--pairs n]
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../physics.hpp"
+#include "../container.hpp"
+#include "../collision.hpp"
+#include "../ccd.hpp"
+
+static const float dts[] = { 0.002f, 0.005f, 0.01f, 0.02f, 0.05f };
+
+// exact free flight for DT, the same path ContinuousStepper follows
+static void move(std::vector<Body> &bodies, float DT) {
+	for (size_t i = 0; i < bodies.size(); ++i){
+		Body &b = bodies[i];
+		glm::vec3 a = b.getAcceleration();
+		b.setPosition(b.getPosition() + b.getVelocity()*DT + a*(0.5f*DT*DT));
+		b.setVelocity(b.getVelocity() + a*DT);
+	}
+}
+
+static void stepDiscrete(std::vector<Body> &bodies, const Container &container, SpatialHash &grid,
+		std::vector<std::pair<int,int> > &pairs, float DT) {
+	move(bodies, DT);
+	for (size_t i = 0; i < bodies.size(); ++i){
+		container.collide(bodies[i], R);
+	}
+	CollideAll(bodies, grid, pairs);
+}
+
+static void fillHeadOn(std::vector<Body> &bodies, int n) {
+	std::mt19937 rng(4321);
+	std::uniform_real_distribution<float> speed(5.0f, 20.0f);
+	bodies.assign(2*n, Body());
+	for (int k = 0; k < n; ++k){
+		// rows 3 apart in y so pairs never meet each other
+		float v = speed(rng);
+		bodies[2*k].setPosition(glm::vec3(-1.5f, 3.0f*k, 0.0f));
+		bodies[2*k].setVelocity(glm::vec3(v, 0.0f, 0.0f));
+		bodies[2*k+1].setPosition(glm::vec3(1.5f, 3.0f*k, 0.0f));
+		bodies[2*k+1].setVelocity(glm::vec3(-v, 0.0f, 0.0f));
+	}
+}
+
+static int countTunnelled(const std::vector<Body> &bodies) {
+	int count = 0;
+	for (size_t k = 0; k + 1 < bodies.size(); k += 2){
+		if (bodies[k].getPosition().x > bodies[k+1].getPosition().x){
+			++count;
+		}
+	}
+	return count;
+}
+
+static void fillGas(std::vector<Body> &bodies, int n) {
+	std::mt19937 rng(1234);
+	float height = n / (0.3f * (4.0f - 2*R) * (4.0f - 2*R));
+	std::uniform_real_distribution<float> xy(-2.0f + R, 2.0f - R);
+	std::uniform_real_distribution<float> z(R, R + height);
+	std::uniform_real_distribution<float> v(-5.0f, 5.0f);
+	bodies.assign(n, Body());
+	for (int i = 0; i < n; ++i){
+		bodies[i].setPosition(glm::vec3(xy(rng), xy(rng), z(rng)));
+		bodies[i].setVelocity(glm::vec3(v(rng), v(rng), v(rng)));
+		bodies[i].setAcceleration(glm::vec3(0.0f, 0.0f, -gravity));
+	}
+}
+
+static double totalEnergy(const std::vector<Body> &bodies) {
+	double e = 0.0;
+	for (size_t i = 0; i < bodies.size(); ++i){
+		glm::vec3 v = bodies[i].getVelocity();
+		e += bodies[i].getMass() * (0.5*glm::dot(v, v) + gravity*bodies[i].getPosition().z);
+	}
+	return e;
+}
+
+static double seconds(std::chrono::high_resolution_clock::time_point a, std::chrono::high_resolution_clock::time_point b) {
+	return std::chrono::duration_cast<std::chrono::duration<double>>(b - a).count();
+}
+
+int main(int argc, char **argv) {
+	int spheres = 2000;
+	int headOn = 1000;
+	for (int i = 1; i < argc; ++i){
+		if (strcmp(argv[i],"--spheres") == 0 && i+1 < argc){
+			spheres = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--pairs") == 0 && i+1 < argc){
+			headOn = atoi(argv[++i]);
+		} else {
+			std::cerr << "usage: " << argv[0] << " [--spheres n] [--pairs n]" << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<Body> bodies;
+	std::vector<std::pair<int,int> > pairs;
+	SpatialHash grid;
+	ContinuousStepper ccd;
+	Container open;
+
+	printf("head-on, %d pairs: pairs that went through each other\n", headOn);
+	printf("%8s %12s %12s\n", "dt", "discrete", "continuous");
+	for (float DT : dts){
+		int steps = (int)std::ceil(0.5f/DT);
+		fillHeadOn(bodies, headOn);
+		grid.init(2*R);
+		for (int s = 0; s < steps; ++s){
+			stepDiscrete(bodies, open, grid, pairs, DT);
+		}
+		int discrete = countTunnelled(bodies);
+
+		fillHeadOn(bodies, headOn);
+		ccd.init(R);
+		for (int s = 0; s < steps; ++s){
+			ccd.step(bodies, open, DT);
+		}
+		printf("%8.3f %12d %12d\n", DT, discrete, countTunnelled(bodies));
+	}
+
+	printf("\ngas, %d spheres, 1 s simulated: ms per simulated second, energy drift\n", spheres);
+	printf("%8s %12s %12s %12s %12s %12s\n", "dt", "discrete ms", "drift %", "ccd ms", "drift %", "contacts/step");
+	for (float DT : dts){
+		int steps = (int)std::ceil(1.0f/DT);
+
+		fillGas(bodies, spheres);
+		double e0 = totalEnergy(bodies);
+		grid.init(2*R);
+		auto t0 = std::chrono::high_resolution_clock::now();
+		for (int s = 0; s < steps; ++s){
+			stepDiscrete(bodies, defaultContainer(), grid, pairs, DT);
+		}
+		double discreteMs = seconds(t0, std::chrono::high_resolution_clock::now())*1e3;
+		double discreteDrift = 100.0*(totalEnergy(bodies) - e0)/std::fabs(e0);
+
+		fillGas(bodies, spheres);
+		ccd.init(R);
+		t0 = std::chrono::high_resolution_clock::now();
+		for (int s = 0; s < steps; ++s){
+			ccd.step(bodies, defaultContainer(), DT);
+		}
+		double ccdMs = seconds(t0, std::chrono::high_resolution_clock::now())*1e3;
+		double ccdDrift = 100.0*(totalEnergy(bodies) - e0)/std::fabs(e0);
+
+		printf("%8.3f %12.2f %12.4f %12.2f %12.4f %12.1f\n", DT, discreteMs, discreteDrift, ccdMs, ccdDrift,
+			(double)ccd.getEvents()/steps);
+	}
+	return 0;
+}
@@ -0,0 +1,109 @@
+// Times the O(N) chain accelerations of PendulumChain against the O(N^3)
+// Lagrangian mass-matrix solve for chains of 2 to 1000 links, checks that
+// the two agree, and runs each chain for a while with RK4 to report the cost
+// of a step and the energy drift.
+//
+// The chain has total length L and unit masses and starts bent, from theta0
+// at the pivot to -theta0/2 at the tip, with a little angular velocity. The
+// fastest mode of the chain is about 2N sqrt(g/L), so the RK4 run uses a step
+// no larger than sqrt(L/g)/(2N).
+//
+// usage: chain_bench [--max n] [--dense-max n] [--time seconds] [--dt seconds]
+
+#include <iostream>
+#include <valarray>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../chain.hpp"
+
+static const int sizes[] = { 2, 3, 5, 10, 20, 50, 100, 200, 500, 1000 };
+
+static double seconds(std::chrono::high_resolution_clock::time_point a, std::chrono::high_resolution_clock::time_point b) {
+	return std::chrono::duration_cast<std::chrono::duration<double>>(b - a).count();
+}
+
+// microseconds per call of fn, repeated until at least 0.1 s has passed
+template<typename Fn>
+static double timeCall(Fn fn) {
+	long long calls = 0;
+	auto t0 = std::chrono::high_resolution_clock::now();
+	double s = 0.0;
+	do {
+		fn();
+		++calls;
+		s = seconds(t0, std::chrono::high_resolution_clock::now());
+	} while (s < 0.1);
+	return s*1e6/calls;
+}
+
+int main(int argc, char **argv) {
+	int maxLinks = 1000;
+	int denseMax = 1000;
+	float simTime = 2.0f;
+	float dt = 0.001f;
+	for (int i = 1; i < argc; ++i){
+		if (strcmp(argv[i],"--max") == 0 && i+1 < argc){
+			maxLinks = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--dense-max") == 0 && i+1 < argc){
+			denseMax = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--time") == 0 && i+1 < argc){
+			simTime = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i],"--dt") == 0 && i+1 < argc){
+			dt = (float)atof(argv[++i]);
+		} else {
+			std::cerr << "usage: " << argv[0] << " [--max n] [--dense-max n] [--time seconds] [--dt seconds]" << std::endl;
+			return 1;
+		}
+	}
+
+	printf("%6s %14s %14s %10s %12s %10s %14s %12s\n", "links", "O(N) us/eval", "dense us/eval", "speedup", "max diff", "dt", "rk4 us/step", "drift");
+	for (int n : sizes){
+		if (n > maxLinks){
+			break;
+		}
+		PendulumChain chain;
+		chain.init(n);
+		for (int i = 0; i < n; ++i){
+			// velocity so the centripetal terms are exercised too
+			chain.setLink(i, theta0*(1.0f - 1.5f*i/n), 0.5f*std::sin(0.3f*i), L/n, 1.0f);
+		}
+		chain.updateAcceleration();
+
+		const PhaseState<std::valarray<float> > &s = chain.getState();
+		std::valarray<float> alpha(n), reference(n);
+		double recursiveUs = timeCall([&]() { chain.accelerations(s.x, s.v, alpha); });
+
+		double denseUs = -1.0, diff = 0.0;
+		if (n <= denseMax){
+			denseUs = timeCall([&]() { chain.accelerationsDense(s.x, s.v, reference); });
+			double scale = 0.0;
+			for (int i = 0; i < n; ++i){
+				diff = std::max(diff, (double)std::fabs(alpha[i] - reference[i]));
+				scale = std::max(scale, (double)std::fabs(reference[i]));
+			}
+			diff /= scale;
+		}
+
+		float e0 = chain.energy();
+		float h = std::min(dt, std::sqrt(L/gravity)/(2.0f*n));
+		int steps = (int)(simTime/h);
+		auto t0 = std::chrono::high_resolution_clock::now();
+		for (int k = 0; k < steps; ++k){
+			chain.step<RK4>(h);
+		}
+		double stepUs = seconds(t0, std::chrono::high_resolution_clock::now())*1e6/steps;
+		double drift = (chain.energy() - e0)/e0;
+
+		if (denseUs >= 0.0){
+			printf("%6d %14.3f %14.3f %10.1f %12.2e %10.2e %14.3f %12.2e\n", n, recursiveUs, denseUs, denseUs/recursiveUs, diff, h, stepUs, drift);
+		} else {
+			printf("%6d %14.3f %14s %10s %12s %10.2e %14.3f %12.2e\n", n, recursiveUs, "-", "-", "-", h, stepUs, drift);
+		}
+		fflush(stdout);
+	}
+	return 0;
+}
@@ -0,0 +1,148 @@
+// Times sphere-sphere collision handling for 100 to 100k free spheres in the
+// CheckBC box (walls at +-2, floor at 0, open top) with the spatial-hash
+// broad phase, against the naive all-pairs loop up to 10k spheres.
+// The column of spheres grows upwards so the density stays the same.
+// Up to 10k spheres every grid step is also checked against the all-pairs
+// loop: both must find the same overlapping pairs, or nothing is timed.
+//
+// usage: collision_bench [--steps n] [--max n]
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../physics.hpp"
+#include "../collision.hpp"
+
+static const float DT = 0.002f;
+static const float spheresPerUnitVolume = 0.3f;
+
+static void fill(std::vector<Body> &bodies, int n) {
+	std::mt19937 rng(1234);
+	float height = n / (spheresPerUnitVolume * (4.0f - 2*R) * (4.0f - 2*R));
+	std::uniform_real_distribution<float> xy(-2.0f + R, 2.0f - R);
+	std::uniform_real_distribution<float> z(R, R + height);
+	std::uniform_real_distribution<float> v(-1.0f, 1.0f);
+	bodies.assign(n, Body());
+	for (int i = 0; i < n; ++i){
+		bodies[i].setPosition(glm::vec3(xy(rng), xy(rng), z(rng)));
+		bodies[i].setVelocity(glm::vec3(v(rng), v(rng), v(rng)));
+	}
+}
+
+// free fall plus the walls, so bodies keep changing cells between steps
+static void move(std::vector<Body> &bodies) {
+	for (size_t i = 0; i < bodies.size(); ++i){
+		Body &b = bodies[i];
+		b.setVelocity(b.getVelocity() + glm::vec3(0.0f, 0.0f, -gravity*DT));
+		b.setPosition(b.getPosition() + b.getVelocity()*DT);
+		CheckBC(b);
+	}
+}
+
+static void collideNaive(std::vector<Body> &bodies) {
+	for (size_t i = 0; i < bodies.size(); ++i){
+		for (size_t j = i + 1; j < bodies.size(); ++j){
+			CollideSpheres(bodies[i], bodies[j]);
+		}
+	}
+}
+
+static bool overlap(const Body &a, const Body &b) {
+	glm::vec3 d = b.getPosition() - a.getPosition();
+	return glm::dot(d, d) < 4*R*R;
+}
+
+// overlapping pairs among the candidates, sorted
+static void overlapping(const std::vector<Body> &bodies, const std::vector<std::pair<int,int> > &candidates,
+                        std::vector<std::pair<int,int> > &found) {
+	found.clear();
+	for (size_t k = 0; k < candidates.size(); ++k){
+		if (overlap(bodies[candidates[k].first], bodies[candidates[k].second])){
+			found.push_back(candidates[k]);
+		}
+	}
+	std::sort(found.begin(), found.end());
+}
+
+static void overlappingNaive(const std::vector<Body> &bodies, std::vector<std::pair<int,int> > &found) {
+	found.clear();
+	for (size_t i = 0; i < bodies.size(); ++i){
+		for (size_t j = i + 1; j < bodies.size(); ++j){
+			if (overlap(bodies[i], bodies[j])){
+				found.push_back(std::make_pair((int)i, (int)j));
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	int steps = 20;
+	int maxCount = 100000;
+	for (int i = 1; i < argc; ++i){
+		if (strcmp(argv[i],"--steps") == 0 && i+1 < argc){
+			steps = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--max") == 0 && i+1 < argc){
+			maxCount = atoi(argv[++i]);
+		} else {
+			std::cerr << "usage: " << argv[0] << " [--steps n] [--max n]" << std::endl;
+			return 1;
+		}
+	}
+
+	printf("%8s %14s %14s %12s %14s\n", "spheres", "grid ms/step", "naive ms/step", "candidates", "ns/sphere");
+	for (int n = 100; n <= maxCount; n *= 10){
+		std::vector<Body> bodies;
+		std::vector<std::pair<int,int> > pairs, gridOverlaps, naiveOverlaps;
+		SpatialHash grid;
+		grid.init(2*R);
+		size_t candidates = 0;
+
+		fill(bodies, n);
+		double gridSeconds = 0.0;
+		for (int s = 0; s < steps; ++s){
+			move(bodies);
+			auto t0 = std::chrono::high_resolution_clock::now();
+			CollideAll(bodies, grid, pairs);
+			auto t1 = std::chrono::high_resolution_clock::now();
+			gridSeconds += std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+			candidates += pairs.size();
+			// CollideAll only changes velocities, so the positions are still
+			// the ones the pairs were found from
+			if (n <= 10000){
+				overlapping(bodies, pairs, gridOverlaps);
+				overlappingNaive(bodies, naiveOverlaps);
+				if (gridOverlaps != naiveOverlaps){
+					fprintf(stderr, "%d spheres, step %d: grid found %zu overlapping pairs, all-pairs %zu\n",
+					        n, s, gridOverlaps.size(), naiveOverlaps.size());
+					return 1;
+				}
+			}
+		}
+
+		double naiveSeconds = -1.0;
+		if (n <= 10000){
+			fill(bodies, n);
+			naiveSeconds = 0.0;
+			for (int s = 0; s < steps; ++s){
+				move(bodies);
+				auto t0 = std::chrono::high_resolution_clock::now();
+				collideNaive(bodies);
+				auto t1 = std::chrono::high_resolution_clock::now();
+				naiveSeconds += std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+			}
+		}
+
+		double gridMs = gridSeconds*1e3/steps;
+		if (naiveSeconds >= 0.0){
+			printf("%8d %14.4f %14.4f %12zu %14.1f\n", n, gridMs, naiveSeconds*1e3/steps, candidates/steps, gridMs*1e6/n);
+		} else {
+			printf("%8d %14.4f %14s %12zu %14.1f\n", n, gridMs, "-", candidates/steps, gridMs*1e6/n);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,142 @@
+// Checks the polynomials of fastmath.hpp against double precision libm over
+// dense sweeps of their input ranges, then times libm, the scalar polynomials
+// and the SIMD polynomials over an array. Exits with status 1 if an error
+// exceeds the bound documented in fastmath.hpp, so it can gate a build that
+// turns on -DFAST_TRIG.
+//
+// usage: fastmath_bench [--n elements] [--reps n]
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "../fastmath.hpp"
+
+struct AccuracyCase
+{
+	const char *name;
+	double from, to;
+	double bound;
+};
+
+static double maxError(int which, double from, double to, double &worstX) {
+	double worst = 0.0;
+	const long long samples = 20000000;
+	for (long long k = 0; k <= samples; ++k){
+		float x = (float)(from + (to - from)*k/samples);
+		float s, c;
+		double err;
+		switch (which){
+			case 0: fastSincos(x, s, c); err = std::fabs(s - std::sin((double)x)); break;
+			case 1: fastSincos(x, s, c); err = std::fabs(c - std::cos((double)x)); break;
+			default: err = std::fabs(fastAtan(x) - std::atan((double)x)); break;
+		}
+		if (err > worst){
+			worst = err;
+			worstX = x;
+		}
+	}
+	return worst;
+}
+
+// SIMD lanes must agree with the scalar result; they may differ in the last
+// bits where the compiler contracts the scalar multiply-adds into FMA
+static bool close(float a, float b) {
+	return std::fabs(a - b) <= 2.5e-7f * std::max(1.0f, std::fabs(b));
+}
+
+static bool lanesMatch() {
+	alignas(SIMD_ALIGN) float in[SIMD_WIDTH], s[SIMD_WIDTH], c[SIMD_WIDTH], a[SIMD_WIDTH];
+	for (float x = -100.0f; x < 100.0f; x += 0.37f){
+		for (int k = 0; k < SIMD_WIDTH; ++k){
+			in[k] = x + 0.01f*k;
+		}
+		vfloat vs, vc;
+		vsincos(vload(in), vs, vc);
+		vstore(s, vs);
+		vstore(c, vc);
+		vstore(a, vatan(vload(in)));
+		for (int k = 0; k < SIMD_WIDTH; ++k){
+			if (!close(s[k], fastSin(in[k])) || !close(c[k], fastCos(in[k])) || !close(a[k], fastAtan(in[k]))){
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+template<typename Fn>
+static double timeLoop(Fn fn, int reps) {
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < reps; ++r){
+		fn();
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+}
+
+int main(int argc, char **argv) {
+	int n = 1 << 20;
+	int reps = 20;
+	for (int i = 1; i < argc; ++i){
+		if (strcmp(argv[i],"--n") == 0 && i+1 < argc){
+			n = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--reps") == 0 && i+1 < argc){
+			reps = atoi(argv[++i]);
+		} else {
+			std::cerr << "usage: " << argv[0] << " [--n elements] [--reps n]" << std::endl;
+			return 1;
+		}
+	}
+	n = (n + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+	if (n <= 0 || reps <= 0){
+		std::cerr << "--n and --reps must be positive" << std::endl;
+		return 1;
+	}
+
+	const AccuracyCase cases[] = {
+		{ "sin", -8192.0, 8192.0, 1e-7 },
+		{ "cos", -8192.0, 8192.0, 1e-7 },
+		{ "atan", -1e4, 1e4, 1.5e-7 },
+	};
+	bool ok = true;
+	printf("%-6s %-20s %12s %12s %14s\n", "fn", "range", "max error", "bound", "worst at");
+	for (int k = 0; k < 3; ++k){
+		double worstX = 0.0;
+		double err = maxError(k, cases[k].from, cases[k].to, worstX);
+		char range[32];
+		snprintf(range, sizeof(range), "[%g, %g]", cases[k].from, cases[k].to);
+		printf("%-6s %-20s %12.3e %12.3e %14.7g%s\n", cases[k].name, range, err, cases[k].bound, worstX,
+		       err > cases[k].bound ? "  FAIL" : "");
+		ok = ok && err <= cases[k].bound;
+	}
+	bool match = lanesMatch();
+	printf("simd (%s) lanes match scalar: %s\n\n", SIMD_NAME, match ? "yes" : "no  FAIL");
+	ok = ok && match;
+
+	float *in = static_cast<float*>(::operator new[](n * sizeof(float), std::align_val_t(SIMD_ALIGN)));
+	float *out = static_cast<float*>(::operator new[](n * sizeof(float), std::align_val_t(SIMD_ALIGN)));
+	for (int i = 0; i < n; ++i){
+		in[i] = -3.0f + 6.0f*i/n;
+	}
+	volatile float sink = 0.0f;
+	double libmSin = timeLoop([&]{ for (int i = 0; i < n; ++i) out[i] = std::sin(in[i]); sink = sink + out[n/2]; }, reps);
+	double fastSinT = timeLoop([&]{ for (int i = 0; i < n; ++i) out[i] = fastSin(in[i]); sink = sink + out[n/2]; }, reps);
+	double vecSin = timeLoop([&]{ for (int i = 0; i < n; i += SIMD_WIDTH) vstore(out+i, vsin(vload(in+i))); sink = sink + out[n/2]; }, reps);
+	double libmAtan = timeLoop([&]{ for (int i = 0; i < n; ++i) out[i] = std::atan(in[i]); sink = sink + out[n/2]; }, reps);
+	double fastAtanT = timeLoop([&]{ for (int i = 0; i < n; ++i) out[i] = fastAtan(in[i]); sink = sink + out[n/2]; }, reps);
+	double vecAtan = timeLoop([&]{ for (int i = 0; i < n; i += SIMD_WIDTH) vstore(out+i, vatan(vload(in+i))); sink = sink + out[n/2]; }, reps);
+
+	double scale = 1e9 / ((double)n * reps);
+	printf("%-6s %12s %12s %12s   (ns per element, %d elements x %d)\n", "fn", "libm", "scalar", SIMD_NAME, n, reps);
+	printf("%-6s %12.3f %12.3f %12.3f\n", "sin", libmSin*scale, fastSinT*scale, vecSin*scale);
+	printf("%-6s %12.3f %12.3f %12.3f\n", "atan", libmAtan*scale, fastAtanT*scale, vecAtan*scale);
+
+	::operator delete[](in, std::align_val_t(SIMD_ALIGN));
+	::operator delete[](out, std::align_val_t(SIMD_ALIGN));
+	return ok ? 0 : 1;
+}
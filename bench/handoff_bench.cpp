@@ -0,0 +1,138 @@
+// Physics inline in the render loop against physics on its own thread
+// handing frames over through TripleBuffer, with the render side stalled
+// for --frame-ms per frame as if waiting for vsync. The physics is an
+// ensemble of --pendulums pendulums stepped with RK4 as fast as possible.
+//
+// Inline, every stall also stops the simulation. Threaded, the simulation
+// runs at full speed and the renderer picks up the newest complete frame.
+// Each frame carries its step number in every slot of an array; the reader
+// checks that they all agree, so a torn handoff would be reported.
+//
+// usage: handoff_bench [--pendulums n] [--frame-ms ms] [--seconds s]
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../physics.hpp"
+#include "../ensemble.hpp"
+#include "../triplebuffer.hpp"
+
+static const float DT = 1.0f/120.0f;
+
+struct Frame
+{
+	long long step;
+	std::vector<long long> stamp;
+	std::vector<glm::vec3> positions;
+};
+
+static void fill(Frame &f, const Ensemble &ensemble, long long step) {
+	f.step = step;
+	for (size_t i = 0; i < f.stamp.size(); ++i){
+		f.stamp[i] = step;
+	}
+	for (int i = 0; i < ensemble.size(); ++i){
+		f.positions[i] = ensemble.getPosition(i);
+	}
+}
+
+static void setup(Ensemble &ensemble, int n) {
+	ensemble.init(n, puntofijo, gravity);
+	for (int i = 0; i < n; ++i){
+		ensemble.setPendulum(i, theta0, 0.0f, 1.0f + (float)i/n, 1.0f);
+	}
+}
+
+static double seconds(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+	return std::chrono::duration_cast<std::chrono::duration<double>>(b - a).count();
+}
+
+int main(int argc, char **argv) {
+	int pendulums = 4096;
+	double frameMs = 16.0;
+	double runSeconds = 2.0;
+	for (int i = 1; i < argc; ++i){
+		if (strcmp(argv[i],"--pendulums") == 0 && i+1 < argc){
+			pendulums = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--frame-ms") == 0 && i+1 < argc){
+			frameMs = atof(argv[++i]);
+		} else if (strcmp(argv[i],"--seconds") == 0 && i+1 < argc){
+			runSeconds = atof(argv[++i]);
+		} else {
+			std::cerr << "usage: " << argv[0] << " [--pendulums n] [--frame-ms ms] [--seconds s]" << std::endl;
+			return 1;
+		}
+	}
+	std::chrono::duration<double, std::milli> stall(frameMs);
+
+	printf("%10s %14s %10s %16s %10s\n", "mode", "steps/s", "frames", "steps behind max", "torn");
+
+	// inline: one step per frame, then the stall
+	{
+		Ensemble ensemble;
+		setup(ensemble, pendulums);
+		long long steps = 0, frames = 0;
+		auto t0 = std::chrono::steady_clock::now();
+		while (seconds(t0, std::chrono::steady_clock::now()) < runSeconds){
+			ensemble.IntegrateRK4(DT);
+			steps++;
+			frames++;
+			std::this_thread::sleep_for(stall);
+		}
+		double s = seconds(t0, std::chrono::steady_clock::now());
+		printf("%10s %14.0f %10lld %16d %10d\n", "inline", steps/s, frames, 0, 0);
+	}
+
+	// threaded: the simulation publishes after every step
+	{
+		Ensemble ensemble;
+		setup(ensemble, pendulums);
+		TripleBuffer<Frame> buffer;
+		for (int k = 0; k < 3; ++k){
+			buffer.slot(k).stamp.assign(256, 0);
+			buffer.slot(k).positions.assign(pendulums, glm::vec3(0.0f));
+		}
+		fill(buffer.writeBuffer(), ensemble, 0);
+		buffer.publish();
+		buffer.update();
+
+		std::atomic<bool> running(true);
+		std::atomic<long long> published(0);
+		std::thread sim([&]() {
+			long long step = 0;
+			while (running.load(std::memory_order_acquire)){
+				ensemble.IntegrateRK4(DT);
+				step++;
+				fill(buffer.writeBuffer(), ensemble, step);
+				buffer.publish();
+				published.store(step, std::memory_order_release);
+			}
+		});
+
+		long long frames = 0, behind = 0, torn = 0;
+		auto t0 = std::chrono::steady_clock::now();
+		while (seconds(t0, std::chrono::steady_clock::now()) < runSeconds){
+			buffer.update();
+			const Frame &f = buffer.readBuffer();
+			for (size_t i = 0; i < f.stamp.size(); ++i){
+				if (f.stamp[i] != f.step){
+					torn++;
+					break;
+				}
+			}
+			behind = std::max(behind, published.load(std::memory_order_acquire) - f.step);
+			frames++;
+			std::this_thread::sleep_for(stall);
+		}
+		running.store(false, std::memory_order_release);
+		sim.join();
+		double s = seconds(t0, std::chrono::steady_clock::now());
+		printf("%10s %14.0f %10lld %16lld %10lld\n", "threaded", published.load()/s, frames, behind, torn);
+	}
+	return 0;
+}
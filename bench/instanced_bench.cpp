@@ -0,0 +1,250 @@
+// Draws N spheres per frame three ways and reports draw calls and CPU frame
+// times: one glUniformMatrix4fv + glDrawElements per sphere (how Sphere used
+// to be drawn, but with a shared mesh), one SphereInstancer upload +
+// glDrawElementsInstanced for all of them, and the viewer's path through
+// transforms.hpp: every model matrix in one ObjectTransforms upload, the
+// camera in a CameraBlock, and one instanced draw reading the matrices by
+// gl_InstanceID. Uses a hidden window, so it runs under Xvfb with Mesa
+// llvmpipe:
+//
+//   xvfb-run -a ./instanced_bench --frames 100
+//
+// "submit" is the CPU time spent issuing the frame's commands, "frame" also
+// waits for glFinish. On llvmpipe rasterisation dominates both; a coarse mesh
+// (--mesh 6 4) leaves mostly the per-draw API cost.
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "../instanced.hpp"
+#include "../mesh.hpp"
+#include "../transforms.hpp"
+
+static const char *vertex_shader = "#version 410\n"
+	"in vec3 vp;"
+	"uniform mat4 model;"
+	"uniform mat4 view;"
+	"uniform mat4 proj;"
+	"void main() {"
+	"  gl_Position = proj * view * model * vec4( vp, 1.0 );"
+	"}";
+
+static const char *vertex_shader_instanced = "#version 410\n"
+	"in vec3 vp;"
+	"in vec3 offset;"
+	"uniform mat4 view;"
+	"uniform mat4 proj;"
+	"void main() {"
+	"  gl_Position = proj * view * vec4( vp + offset, 1.0 );"
+	"}";
+
+static const char *vertex_shader_objects[] = { "#version 410\n", cameraShaderSource, objectShaderSource,
+	"in vec3 vp;"
+	"void main() {"
+	"  gl_Position = proj * view * objectModel() * vec4( vp, 1.0 );"
+	"}" };
+
+static const char *fragment_shader = "#version 410\n"
+	"out vec4 frag_colour;"
+	"void main() {"
+	"  frag_colour = vec4( 0.5, 0.5, 0.5, 1.0 );"
+	"}";
+
+static GLuint buildProgram(const char *const *vsText, int parts = 1) {
+	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vs, parts, vsText, NULL);
+	glCompileShader(vs);
+	GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fs, 1, &fragment_shader, NULL);
+	glCompileShader(fs);
+	GLuint program = glCreateProgram();
+	glAttachShader(program, fs);
+	glAttachShader(program, vs);
+	// same location in every program, so one vertex array serves them all
+	glBindAttribLocation(program, 0, "vp");
+	glLinkProgram(program);
+	return program;
+}
+
+static glm::mat4 benchView() {
+	return glm::lookAt(glm::vec3(0.0f, -40.0f, 40.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+}
+
+static glm::mat4 benchProj() {
+	return glm::perspective(glm::radians(45.0f), 1.0f, 1.0f, 200.0f);
+}
+
+static void setCamera(GLuint program) {
+	glm::mat4 view = benchView();
+	glm::mat4 proj = benchProj();
+	glUseProgram(program);
+	glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+	glUniformMatrix4fv(glGetUniformLocation(program, "proj"), 1, GL_FALSE, glm::value_ptr(proj));
+}
+
+struct Timing
+{
+	double submitMs;
+	double frameMs;
+};
+
+template <typename DrawFn>
+static Timing timeFrames(GLFWwindow *window, int frames, DrawFn drawFrame) {
+	double submit = 0.0, total = 0.0;
+	for (int f = 0; f < frames + 5; ++f){
+		auto t0 = std::chrono::high_resolution_clock::now();
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		drawFrame(f);
+		auto t1 = std::chrono::high_resolution_clock::now();
+		glFinish();
+		auto t2 = std::chrono::high_resolution_clock::now();
+		glfwSwapBuffers(window);
+		if (f >= 5){	// skip warm-up frames
+			submit += std::chrono::duration_cast<std::chrono::duration<double> >(t1 - t0).count();
+			total += std::chrono::duration_cast<std::chrono::duration<double> >(t2 - t0).count();
+		}
+	}
+	Timing t = { submit*1e3/frames, total*1e3/frames };
+	return t;
+}
+
+int main(int argc, char **argv) {
+	int frames = 50;
+	int maxCount = 10000;
+	int sectors = 36, stacks = 18;
+	for (int i = 1; i < argc; ++i){
+		if (strcmp(argv[i],"--frames") == 0 && i+1 < argc){
+			frames = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--max") == 0 && i+1 < argc){
+			maxCount = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--mesh") == 0 && i+2 < argc){
+			sectors = atoi(argv[++i]);
+			stacks = atoi(argv[++i]);
+		} else {
+			std::cerr << "usage: " << argv[0] << " [--frames n] [--max n] [--mesh sectors stacks]" << std::endl;
+			return 1;
+		}
+	}
+
+	if (!glfwInit()){
+		return 1;
+	}
+	glfwWindowHint(GLFW_VISIBLE, 0);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, 1);
+	GLFWwindow *window = glfwCreateWindow(256, 256, "instanced_bench", NULL, NULL);
+	if (!window){
+		std::cerr << "cannot create a GL 4.1 context" << std::endl;
+		glfwTerminate();
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(0);
+	glewExperimental = GL_TRUE;
+	glewInit();
+	glEnable(GL_DEPTH_TEST);
+	std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+	GLuint program = buildProgram(&vertex_shader);
+	GLuint programInstanced = buildProgram(&vertex_shader_instanced);
+	GLuint programObjects = buildProgram(vertex_shader_objects, 4);
+	setCamera(program);
+	setCamera(programInstanced);
+	CameraBlock camera;
+	camera.init();
+	camera.attach(programObjects);
+	GLint uniModel = glGetUniformLocation(program, "model");
+	GLuint vp = glGetAttribLocation(program, "vp");
+
+	// one mesh for the per-object path, so only the per-draw overhead differs
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+	buildSphereMesh(0.2f, sectors, stacks, vertices, indices);
+	GLuint vao, vbo, ibo;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), &vertices[0], GL_STATIC_DRAW);
+	glVertexAttribPointer(vp, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+	glEnableVertexAttribArray(vp);
+	glGenBuffers(1, &ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+	glBindVertexArray(0);
+
+	printf("%8s %10s %12s %12s %10s %12s %12s %10s %12s %12s\n", "spheres", "calls", "submit ms", "frame ms",
+	       "calls", "submit ms", "frame ms", "calls", "submit ms", "frame ms");
+	printf("%8s %36s %36s %36s\n", "", "per-object", "instanced", "transform buffer");
+	for (int n = 10; n <= maxCount; n *= 10){
+		std::vector<glm::vec3> positions(n);
+		int side = 1;
+		while (side*side < n){
+			++side;
+		}
+		for (int i = 0; i < n; ++i){
+			positions[i] = glm::vec3(-10.0f + 20.0f*(i % side)/side, -10.0f + 20.0f*(i / side)/side, 0.0f);
+		}
+
+		glUseProgram(program);
+		Timing perObject = timeFrames(window, frames, [&](int f) {
+			glBindVertexArray(vao);
+			for (int i = 0; i < n; ++i){
+				glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[i] + glm::vec3(0.0f, 0.0f, 0.01f*(f % 10)));
+				glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(model));
+				glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, NULL);
+			}
+		});
+
+		SphereInstancer instancer;
+		glUseProgram(programInstanced);
+		instancer.init(glGetAttribLocation(programInstanced, "vp"), glGetAttribLocation(programInstanced, "offset"), 0.2f, n, sectors, stacks);
+		std::vector<glm::vec3> moved(n);
+		Timing instanced = timeFrames(window, frames, [&](int f) {
+			for (int i = 0; i < n; ++i){
+				moved[i] = positions[i] + glm::vec3(0.0f, 0.0f, 0.01f*(f % 10));
+			}
+			instancer.update(&moved[0], n);
+			instancer.draw();
+		});
+		instancer.cleanup();
+
+		// camera and all model matrices uploaded once per frame, then a
+		// single draw; the only per-draw uniform is objectBase
+		ObjectTransforms objects;
+		objects.init(n);
+		GLint uniObjectBase = objects.attach(programObjects);
+		Timing buffered = timeFrames(window, frames, [&](int f) {
+			camera.update(benchView(), benchProj());
+			objects.clear();
+			for (int i = 0; i < n; ++i){
+				objects.add(positions[i] + glm::vec3(0.0f, 0.0f, 0.01f*(f % 10)));
+			}
+			objects.upload();
+			glUniform1i(uniObjectBase, 0);
+			glBindVertexArray(vao);
+			glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, NULL, n);
+		});
+		objects.cleanup();
+
+		printf("%8d %10d %12.3f %12.3f %10d %12.3f %12.3f %10d %12.3f %12.3f\n", n, n, perObject.submitMs, perObject.frameMs,
+		       1, instanced.submitMs, instanced.frameMs, 1, buffered.submitMs, buffered.frameMs);
+	}
+
+	camera.cleanup();
+	glDeleteBuffers(1, &vbo);
+	glDeleteBuffers(1, &ibo);
+	glDeleteVertexArrays(1, &vao);
+	glfwTerminate();
+	return 0;
+}
@@ -0,0 +1,74 @@
+// Times the hand-written integrators of physics.cpp against the templated
+// schemes of integrators.hpp on the default pendulum, and reports how far
+// each one lets the energy and the rod length drift over the run.
+// Force evaluations per step: euler 1, midpoint/heun 2, rk3 3, rk4 4,
+// verlet/leapfrog 1, yoshida4 3.
+//
+// usage: integrator_bench [--dt seconds] [--time seconds]
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../physics.hpp"
+#include "../integrators.hpp"
+
+typedef void (*StepFn)(Body &, float, const PendulumParams &);
+
+static void run(const char *name, StepFn step, float dt, long long steps) {
+	Body sphere;
+	initPendulum(sphere);
+	float e0 = pendulumEnergy(sphere);
+	float maxError = 0.0f;
+	float maxStretch = 0.0f;
+
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (long long n = 0; n < steps; ++n){
+		step(sphere, dt, defaultParams);
+		// cheap enough next to the step to keep in the timed loop for every scheme
+		maxError = std::max(maxError, std::abs(pendulumEnergy(sphere) - e0));
+		maxStretch = std::max(maxStretch, std::abs(glm::distance(sphere.getPosition(), puntofijo) - L));
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+	double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+
+	printf("%-18s %12.0f %12.2f %14.3e %14.3e\n", name, steps/seconds, seconds*1e9/steps, maxError/e0, maxStretch);
+}
+
+int main(int argc, char **argv) {
+	float dt = 0.001f;
+	float time = 60.0f;
+	for (int i = 1; i < argc; ++i){
+		if (strcmp(argv[i],"--dt") == 0 && i+1 < argc){
+			dt = atof(argv[++i]);
+		} else if (strcmp(argv[i],"--time") == 0 && i+1 < argc){
+			time = atof(argv[++i]);
+		} else {
+			std::cerr << "usage: " << argv[0] << " [--dt seconds] [--time seconds]" << std::endl;
+			return 1;
+		}
+	}
+	if (dt <= 0.0f || time <= 0.0f){
+		std::cerr << "--dt and --time must be positive" << std::endl;
+		return 1;
+	}
+	long long steps = (long long)(time/dt + 0.5f);
+
+	printf("%lld steps of %g s\n", steps, dt);
+	printf("%-18s %12s %12s %14s %14s\n", "scheme", "steps/s", "ns/step", "max dE/E0", "max |r|-L");
+	run("IntegrateEuler", IntegrateEuler, dt, steps);
+	run("IntegrateRK4", IntegrateRK4, dt, steps);
+	run("IntegrateVerlet", IntegrateVerlet, dt, steps);
+	run("Euler", IntegrateBody<Euler>, dt, steps);
+	run("Midpoint", IntegrateBody<Midpoint>, dt, steps);
+	run("Heun", IntegrateBody<Heun>, dt, steps);
+	run("RK3", IntegrateBody<RK3>, dt, steps);
+	run("RK4", IntegrateBody<RK4>, dt, steps);
+	run("VelocityVerlet", IntegrateBody<VelocityVerlet>, dt, steps);
+	run("Leapfrog", IntegrateBody<Leapfrog>, dt, steps);
+	run("Yoshida4", IntegrateBody<Yoshida4>, dt, steps);
+	return 0;
+}
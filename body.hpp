@@ -0,0 +1,31 @@
+#ifndef BODY_H
+#define BODY_H
+
+#include <glm/glm.hpp>
+
+// Physical state of a point mass. Kept free of any GL types so the physics
+// can be built and run without a window or context.
+class Body
+{
+public:
+    Body() : position(0.0f), velocity(0.0f), acceleration(0.0f), mass(1.0f) {}
+
+    glm::vec3 getPosition() const { return position; }
+	glm::vec3 getVelocity() const { return velocity; }
+	glm::vec3 getAcceleration() const { return acceleration; }
+
+	void setPosition(const glm::vec3& a) { position = a; }
+	void setVelocity(const glm::vec3& a) { velocity = a; }
+	void setAcceleration(const glm::vec3& a) { acceleration = a; }
+
+	float getMass() const { return mass; }
+	void setMass(const float a) { mass = a; }
+
+private:
+    glm::vec3 position;
+    glm::vec3 velocity;
+    glm::vec3 acceleration;
+    float mass;
+};
+
+#endif // BODY_H
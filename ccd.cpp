@@ -0,0 +1,305 @@
+#include "ccd.hpp"
+
+#include <cmath>
+#include <queue>
+#include <algorithm>
+
+static const float never = 1e30f;
+
+// state of the body t seconds further along its ballistic path
+static void ballistic(const Body &b, float t, glm::vec3 &p, glm::vec3 &v)
+{
+    glm::vec3 a = b.getAcceleration();
+    p = b.getPosition() + b.getVelocity()*t + a*(0.5f*t*t);
+    v = b.getVelocity() + a*t;
+}
+
+static void advance(Body &b, float t)
+{
+    if (t <= 0.0f) {
+        return;
+    }
+    glm::vec3 p, v;
+    ballistic(b, t, p, v);
+    b.setPosition(p);
+    b.setVelocity(v);
+}
+
+bool planeTimeOfImpact(const Body &body, const ContainerPlane &plane, float radius, float dt, float &t)
+{
+    const glm::vec3 &n = plane.normal;
+    // d(t) = C + B*t + A*t^2 is the gap between the sphere and the plane
+    float C = glm::dot(n, body.getPosition()) - plane.offset - radius;
+    float B = glm::dot(n, body.getVelocity());
+    float A = 0.5f*glm::dot(n, body.getAcceleration());
+    if (C <= 0.0f) {
+        if (B < 0.0f) {
+            t = 0.0f;
+            return true;
+        }
+        return false;
+    }
+
+    float first = never;
+    if (A == 0.0f) {
+        if (B < 0.0f) {
+            first = -C/B;
+        }
+    } else {
+        float disc = B*B - 4.0f*A*C;
+        if (disc < 0.0f) {
+            return false;
+        }
+        // both roots without cancellation; q is never 0 here since C > 0
+        float q = -0.5f*(B + std::copysign(std::sqrt(disc), B));
+        float r1 = q/A, r2 = C/q;
+        if (r1 > 0.0f) {
+            first = r1;
+        }
+        if (r2 > 0.0f && r2 < first) {
+            first = r2;
+        }
+    }
+    if (first > dt) {
+        return false;
+    }
+    t = first;
+    return true;
+}
+
+bool sphereTimeOfImpact(const Body &a, const Body &b, float radius, float dt, float &t)
+{
+    glm::vec3 dp = b.getPosition() - a.getPosition();
+    glm::vec3 dv = b.getVelocity() - a.getVelocity();
+    float D = 2.0f*radius;
+    // |dp + dv*t|^2 = D^2, with half the linear coefficient in hb
+    float hb = glm::dot(dp, dv);
+    if (hb >= 0.0f) {
+        return false;   // separating or at rest relative to each other
+    }
+    float c = glm::dot(dp, dp) - D*D;
+    if (c <= 0.0f) {
+        t = 0.0f;
+        return true;
+    }
+    float disc = hb*hb - glm::dot(dv, dv)*c;
+    if (disc < 0.0f) {
+        return false;
+    }
+    float first = c/(std::sqrt(disc) - hb);
+    if (first > dt) {
+        return false;
+    }
+    t = first;
+    return true;
+}
+
+// reflects the velocity into the plane and pushes the body back out of it
+static void resolveWall(Body &b, const ContainerPlane &plane, float radius)
+{
+    const glm::vec3 &n = plane.normal;
+    glm::vec3 v = b.getVelocity();
+    float vn = glm::dot(n, v);
+    if (vn < 0.0f) {
+        b.setVelocity(v - n*((1.0f + plane.restitution)*vn));
+    }
+    float d = glm::dot(n, b.getPosition()) - plane.offset - radius;
+    if (d < 0.0f) {
+        b.setPosition(b.getPosition() - n*d);
+    }
+}
+
+// elastic impulse along the line of centres
+static void resolvePair(Body &a, Body &b)
+{
+    glm::vec3 dp = b.getPosition() - a.getPosition();
+    float len = glm::length(dp);
+    if (len <= 0.0f) {
+        return;
+    }
+    glm::vec3 n = dp/len;
+    float u = glm::dot(b.getVelocity() - a.getVelocity(), n);
+    if (u >= 0.0f) {
+        return;
+    }
+    float ima = 1.0f/a.getMass(), imb = 1.0f/b.getMass();
+    float j = -2.0f*u/(ima + imb);
+    a.setVelocity(a.getVelocity() - n*(j*ima));
+    b.setVelocity(b.getVelocity() + n*(j*imb));
+}
+
+// contact queue entry; id < bodies is a wall contact of that body, otherwise
+// a pair contact of pair id - bodies. Entries whose time no longer matches
+// the current time of their contact are stale and skipped.
+struct CcdEvent
+{
+    float time;
+    int id;
+    bool operator<(const CcdEvent &o) const { return time > o.time; }
+};
+
+ContinuousStepper::ContinuousStepper()
+{
+    radius = 0.5f;
+    maxEvents = 4096;
+    cellSize = 0.0f;
+    events = 0;
+    cappedSteps = 0;
+}
+
+void ContinuousStepper::init(float r, int max)
+{
+    cleanup();
+    radius = r;
+    maxEvents = max > 0 ? max : 1;
+}
+
+void ContinuousStepper::cleanup()
+{
+    grid.cleanup();
+    cellSize = 0.0f;
+    pairs.clear();
+    bodyPairs.clear();
+    bodyTime.clear();
+    wallTime.clear();
+    wallPlane.clear();
+    pairTime.clear();
+    events = 0;
+    cappedSteps = 0;
+}
+
+void ContinuousStepper::wallEvent(const std::vector<Body> &bodies, const Container &container, int i, float DT)
+{
+    wallTime[i] = never;
+    wallPlane[i] = -1;
+    float left = DT - bodyTime[i];
+    for (int k = 0; k < container.size(); ++k) {
+        float t;
+        if (planeTimeOfImpact(bodies[i], container.plane(k), radius, left, t) && bodyTime[i] + t < wallTime[i]) {
+            wallTime[i] = bodyTime[i] + t;
+            wallPlane[i] = k;
+        }
+    }
+}
+
+void ContinuousStepper::pairEvent(const std::vector<Body> &bodies, int k, float DT)
+{
+    int i = pairs[k].first, j = pairs[k].second;
+    float t0 = std::max(bodyTime[i], bodyTime[j]);
+    // both bodies at the same time, without moving the one that is behind
+    Body a = bodies[i], b = bodies[j];
+    advance(a, t0 - bodyTime[i]);
+    advance(b, t0 - bodyTime[j]);
+    float t;
+    pairTime[k] = sphereTimeOfImpact(a, b, radius, DT - t0, t) ? t0 + t : never;
+}
+
+int ContinuousStepper::step(std::vector<Body> &bodies, const Container &container, float DT)
+{
+    const int n = (int)bodies.size();
+
+    // cells wide enough that any two bodies that can meet during the step are neighbours
+    float maxTravel = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        float travel = glm::length(bodies[i].getVelocity())*DT + 0.5f*glm::length(bodies[i].getAcceleration())*DT*DT;
+        maxTravel = std::max(maxTravel, travel);
+    }
+    float needed = 2.0f*radius + 2.0f*maxTravel;
+    if (needed > cellSize || needed < 0.5f*cellSize) {
+        cellSize = 1.25f*needed;
+        grid.init(cellSize);
+    }
+    grid.update(bodies);
+    grid.findPairs(pairs);
+
+    const int np = (int)pairs.size();
+    bodyPairs.resize(n);
+    for (int i = 0; i < n; ++i) {
+        bodyPairs[i].clear();
+    }
+    for (int k = 0; k < np; ++k) {
+        bodyPairs[pairs[k].first].push_back(k);
+        bodyPairs[pairs[k].second].push_back(k);
+    }
+    bodyTime.assign(n, 0.0f);
+    wallTime.assign(n, never);
+    wallPlane.assign(n, -1);
+    pairTime.assign(np, never);
+
+    std::priority_queue<CcdEvent> queue;
+    for (int i = 0; i < n; ++i) {
+        wallEvent(bodies, container, i, DT);
+        if (wallTime[i] < never) {
+            queue.push({ wallTime[i], i });
+        }
+    }
+    for (int k = 0; k < np; ++k) {
+        pairEvent(bodies, k, DT);
+        if (pairTime[k] < never) {
+            queue.push({ pairTime[k], n + k });
+        }
+    }
+
+    int resolved = 0;
+    while (!queue.empty() && resolved < maxEvents) {
+        CcdEvent e = queue.top();
+        queue.pop();
+        int touched[2] = { -1, -1 };
+        if (e.id < n) {
+            int i = e.id;
+            if (wallTime[i] != e.time) {
+                continue;
+            }
+            advance(bodies[i], e.time - bodyTime[i]);
+            bodyTime[i] = e.time;
+            resolveWall(bodies[i], container.plane(wallPlane[i]), radius);
+            touched[0] = i;
+        } else {
+            int k = e.id - n;
+            if (pairTime[k] != e.time) {
+                continue;
+            }
+            int i = pairs[k].first, j = pairs[k].second;
+            advance(bodies[i], e.time - bodyTime[i]);
+            advance(bodies[j], e.time - bodyTime[j]);
+            bodyTime[i] = bodyTime[j] = e.time;
+            resolvePair(bodies[i], bodies[j]);
+            touched[0] = i;
+            touched[1] = j;
+        }
+        ++resolved;
+
+        // only the bodies that changed course need new contact times
+        for (int m = 0; m < 2 && touched[m] >= 0; ++m) {
+            int i = touched[m];
+            wallEvent(bodies, container, i, DT);
+            if (wallTime[i] < never) {
+                queue.push({ wallTime[i], i });
+            }
+            for (int k : bodyPairs[i]) {
+                pairEvent(bodies, k, DT);
+                if (pairTime[k] < never) {
+                    queue.push({ pairTime[k], n + k });
+                }
+            }
+        }
+    }
+    bool capped = !queue.empty() && resolved >= maxEvents;
+
+    for (int i = 0; i < n; ++i) {
+        advance(bodies[i], DT - bodyTime[i]);
+        container.collide(bodies[i], radius);
+    }
+    if (capped) {
+        ++cappedSteps;
+        for (int k = 0; k < np; ++k) {
+            Body &a = bodies[pairs[k].first];
+            Body &b = bodies[pairs[k].second];
+            if (glm::distance(a.getPosition(), b.getPosition()) < 2.0f*radius) {
+                resolvePair(a, b);
+            }
+        }
+    }
+    events += resolved;
+    return resolved;
+}
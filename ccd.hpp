@@ -0,0 +1,69 @@
+#ifndef CCD_H
+#define CCD_H
+
+#include <utility>
+#include <vector>
+#include "body.hpp"
+#include "container.hpp"
+#include "collision.hpp"
+
+// Continuous collision detection for free spheres. Between contacts a body
+// follows its ballistic path, x(t) = x + v*t + a*t^2/2 with the acceleration
+// stored in the Body, so contacts inside a step are found at their exact time
+// instead of as an overlap at the end of the step.
+
+// Earliest t in [0, dt] at which a sphere of the given radius touches the
+// plane while moving into it. A body already crossing the plane and moving
+// in gives t = 0; one resting on it or moving away gives no contact.
+bool planeTimeOfImpact(const Body &body, const ContainerPlane &plane, float radius, float dt, float &t);
+// Earliest t in [0, dt] at which two spheres of the given radius touch while
+// approaching. The relative motion is taken as linear, which is exact when
+// both bodies have the same acceleration (free fall in the same field).
+bool sphereTimeOfImpact(const Body &a, const Body &b, float radius, float dt, float &t);
+
+// Steps free spheres in a container by processing their contacts in time
+// order within the step: the bodies of the earliest contact are moved to its
+// time, the contact is resolved (restitution of the plane for walls, elastic
+// for sphere pairs) and the rest of the step continues from there. Only the
+// bodies involved in a contact are moved and have their next contacts
+// recomputed; the others stay at their own time until the end of the step.
+//
+// Candidate pairs come from a SpatialHash whose cells cover 2*radius plus the
+// farthest any body can travel in the step. Bodies resting on a wall, and
+// anything left over when maxEvents contacts have been resolved in one step,
+// are handled by the discrete Container::collide() and SphereCollision() at
+// the end of the step.
+class ContinuousStepper
+{
+public:
+    ContinuousStepper();
+    void init(float radius, int maxEvents = 4096);
+    void cleanup();
+
+    // advances every body by DT; returns the number of contacts resolved
+    int step(std::vector<Body> &bodies, const Container &container, float DT);
+
+    long long getEvents() const { return events; }
+    // steps that hit maxEvents and relied on the discrete pass
+    long long getCappedSteps() const { return cappedSteps; }
+    int getCandidatePairs() const { return (int)pairs.size(); }
+
+private:
+    void wallEvent(const std::vector<Body> &bodies, const Container &container, int i, float DT);
+    void pairEvent(const std::vector<Body> &bodies, int k, float DT);
+
+    float radius;
+    int maxEvents;
+    float cellSize;
+    SpatialHash grid;
+    std::vector<std::pair<int, int> > pairs;
+    std::vector<std::vector<int> > bodyPairs;   // pairs each body is part of
+    std::vector<float> bodyTime;                // time within the step each body is at
+    std::vector<float> wallTime;                // absolute time of each body's next wall contact
+    std::vector<int> wallPlane;
+    std::vector<float> pairTime;                // absolute time of each pair's next contact
+    long long events;
+    long long cappedSteps;
+};
+
+#endif // CCD_H
@@ -0,0 +1,226 @@
+#include "chain.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+PendulumChain::PendulumChain()
+{
+    pivot = puntofijo;
+    gravity = ::gravity;
+    evaluations = 0;
+}
+
+void PendulumChain::init(int links, const glm::vec3 &p, float g)
+{
+    cleanup();
+    pivot = p;
+    gravity = g;
+    length.assign(links, L/links);
+    mass.assign(links, 1.0f);
+    state.x.resize(links, 0.0f);
+    state.v.resize(links, 0.0f);
+    state.a.resize(links, 0.0f);
+    s.resize(links);
+    c.resize(links);
+    diag.resize(links);
+    off.resize(links);
+    rhs.resize(links);
+    tension.resize(links + 1);
+    for (int k = 0; k < CHAIN_MAX_STAGES; ++k) {
+        kx[k].resize(links);
+        kv[k].resize(links);
+    }
+    xi.resize(links);
+    vi.resize(links);
+}
+
+void PendulumChain::cleanup()
+{
+    length.clear();
+    mass.clear();
+    state.x.resize(0);
+    state.v.resize(0);
+    state.a.resize(0);
+    s.clear();
+    c.clear();
+    diag.clear();
+    off.clear();
+    rhs.clear();
+    tension.clear();
+    for (int k = 0; k < CHAIN_MAX_STAGES; ++k) {
+        kx[k].resize(0);
+        kv[k].resize(0);
+    }
+    xi.resize(0);
+    vi.resize(0);
+    evaluations = 0;
+}
+
+void PendulumChain::setLink(int i, float theta, float omega, float l, float m)
+{
+    state.x[i] = theta;
+    state.v[i] = omega;
+    length[i] = l;
+    mass[i] = m;
+}
+
+void PendulumChain::saveState(std::vector<float> &values) const
+{
+    values.insert(values.end(), std::begin(state.x), std::end(state.x));
+    values.insert(values.end(), std::begin(state.v), std::end(state.v));
+    values.insert(values.end(), std::begin(state.a), std::end(state.a));
+    values.insert(values.end(), length.begin(), length.end());
+    values.insert(values.end(), mass.begin(), mass.end());
+}
+
+const float *PendulumChain::loadState(const float *values)
+{
+    const int n = size();
+    std::copy(values, values + n, std::begin(state.x));
+    std::copy(values + n, values + 2*n, std::begin(state.v));
+    std::copy(values + 2*n, values + 3*n, std::begin(state.a));
+    std::copy(values + 3*n, values + 4*n, length.begin());
+    std::copy(values + 4*n, values + 5*n, mass.begin());
+    return values + 5*n;
+}
+
+void PendulumChain::updateAcceleration()
+{
+    accelerations(state.x, state.v, state.a);
+}
+
+void PendulumChain::accelerations(const std::valarray<float> &theta, const std::valarray<float> &omega,
+                                  std::valarray<float> &alpha) const
+{
+    const int n = size();
+    ++evaluations;
+    for (int i = 0; i < n; ++i) {
+        s[i] = std::sin(theta[i]);
+        c[i] = std::cos(theta[i]);
+    }
+
+    // Rod i points along u_i = (sin, -cos). Keeping it at its length,
+    // u_i.(a_i - a_{i-1}) = -l_i w_i^2, with a_i = g + (T_{i+1} u_{i+1} - T_i u_i)/m_i
+    // gives row i: T_i (1/m_i + 1/m_{i-1}) - T_{i+1} u_i.u_{i+1}/m_i
+    // - T_{i-1} u_{i-1}.u_i/m_{i-1} = l_i w_i^2, plus u_0.g for the first rod,
+    // whose pivot does not move.
+    for (int i = 0; i < n; ++i) {
+        double w = omega[i];
+        diag[i] = 1.0/mass[i];
+        rhs[i] = length[i]*w*w;
+        if (i > 0) {
+            diag[i] += 1.0/mass[i-1];
+        }
+        if (i + 1 < n) {
+            off[i] = -(s[i]*s[i+1] + c[i]*c[i+1])/mass[i];
+        }
+    }
+    rhs[0] += gravity*c[0];
+
+    // symmetric tridiagonal solve; the system is positive definite, so no pivoting
+    for (int i = 1; i < n; ++i) {
+        double f = off[i-1]/diag[i-1];
+        diag[i] -= f*off[i-1];
+        rhs[i] -= f*rhs[i-1];
+    }
+    tension[n] = 0.0;
+    tension[n-1] = rhs[n-1]/diag[n-1];
+    for (int i = n - 2; i >= 0; --i) {
+        tension[i] = (rhs[i] - off[i]*tension[i+1])/diag[i];
+    }
+
+    // alpha_i = u'_i.(a_i - a_{i-1})/l_i with u'_i = (cos, sin)
+    double pax = 0.0, paz = 0.0;
+    for (int i = 0; i < n; ++i) {
+        double ax = -tension[i]*s[i]/mass[i];
+        double az = -gravity + tension[i]*c[i]/mass[i];
+        if (i + 1 < n) {
+            ax += tension[i+1]*s[i+1]/mass[i];
+            az -= tension[i+1]*c[i+1]/mass[i];
+        }
+        alpha[i] = float((c[i]*(ax - pax) + s[i]*(az - paz))/length[i]);
+        pax = ax;
+        paz = az;
+    }
+}
+
+void PendulumChain::accelerationsDense(const std::valarray<float> &theta, const std::valarray<float> &omega,
+                                       std::valarray<float> &alpha) const
+{
+    const int n = size();
+    // mu_i: mass from bob i to the end of the chain
+    std::vector<double> mu(n + 1, 0.0);
+    for (int i = n - 1; i >= 0; --i) {
+        mu[i] = mu[i+1] + mass[i];
+    }
+
+    // M_ij = mu_max(i,j) l_i l_j cos(theta_i - theta_j), and the right-hand
+    // side holds the velocity terms and gravity
+    std::vector<double> M(n*n), b(n);
+    for (int i = 0; i < n; ++i) {
+        b[i] = -mu[i]*gravity*length[i]*std::sin(theta[i]);
+        for (int j = 0; j < n; ++j) {
+            double k = mu[std::max(i, j)]*length[i]*length[j];
+            double d = (double)theta[i] - theta[j];
+            M[i*n + j] = k*std::cos(d);
+            b[i] -= k*std::sin(d)*omega[j]*omega[j];
+        }
+    }
+
+    // Gaussian elimination with partial pivoting
+    for (int k = 0; k < n; ++k) {
+        int p = k;
+        for (int i = k + 1; i < n; ++i) {
+            if (std::fabs(M[i*n + k]) > std::fabs(M[p*n + k])) {
+                p = i;
+            }
+        }
+        if (p != k) {
+            for (int j = k; j < n; ++j) {
+                std::swap(M[k*n + j], M[p*n + j]);
+            }
+            std::swap(b[k], b[p]);
+        }
+        for (int i = k + 1; i < n; ++i) {
+            double f = M[i*n + k]/M[k*n + k];
+            for (int j = k; j < n; ++j) {
+                M[i*n + j] -= f*M[k*n + j];
+            }
+            b[i] -= f*b[k];
+        }
+    }
+    for (int i = n - 1; i >= 0; --i) {
+        double sum = b[i];
+        for (int j = i + 1; j < n; ++j) {
+            sum -= M[i*n + j]*alpha[j];
+        }
+        alpha[i] = float(sum/M[i*n + i]);
+    }
+}
+
+void PendulumChain::getPositions(std::vector<glm::vec3> &points) const
+{
+    const int n = size();
+    points.resize(n + 1);
+    points[0] = pivot;
+    for (int i = 0; i < n; ++i) {
+        float th = state.x[i];
+        points[i+1] = points[i] + length[i]*glm::vec3(std::sin(th), 0.0f, -std::cos(th));
+    }
+}
+
+float PendulumChain::energy() const
+{
+    double kinetic = 0.0, potential = 0.0;
+    double vx = 0.0, vz = 0.0, z = 0.0, zRest = 0.0;
+    for (int i = 0; i < size(); ++i) {
+        double th = state.x[i], w = state.v[i];
+        vx += length[i]*w*std::cos(th);
+        vz += length[i]*w*std::sin(th);
+        z -= length[i]*std::cos(th);
+        zRest -= length[i];
+        kinetic += 0.5*mass[i]*(vx*vx + vz*vz);
+        potential += mass[i]*gravity*(z - zRest);
+    }
+    return float(kinetic + potential);
+}
@@ -0,0 +1,183 @@
+#ifndef CHAIN_H
+#define CHAIN_H
+
+#include <valarray>
+#include <vector>
+#include <glm/glm.hpp>
+#include "physics.hpp"
+#include "integrators.hpp"
+
+// A planar chain of N pendulums in the x/z plane: link i is a massless rod of
+// length l_i from bob i-1 (the pivot for the first link) to bob i, a point of
+// mass m_i. The state is the absolute angle of each rod from the vertical,
+// positive towards +x like pendulumAngle(), and its angular velocity.
+//
+// Accelerations are found in O(N). The rods can only pull or push along
+// themselves, so bob i feels -T_i u_i + T_{i+1} u_{i+1}, and keeping each rod
+// at its length gives one equation per rod in the tensions of its two
+// neighbours. That tridiagonal system is solved by elimination from the first
+// link down and substitution back up, and the angular accelerations follow
+// from the bob accelerations. accelerationsDense() solves the same motion
+// from the full Lagrangian mass matrix in O(N^3), as a reference.
+//
+// step() runs the explicit Runge-Kutta, velocity Verlet and leapfrog schemes
+// of integrators.hpp in stage buffers sized by init(), with the same float
+// arithmetic as S::step, so stepping a chain does not allocate.
+#define CHAIN_MAX_STAGES 4    // largest explicit tableau step() takes in place
+
+template<typename S> struct ChainStepper;
+
+class PendulumChain
+{
+public:
+    PendulumChain();
+    void init(int links, const glm::vec3 &pivot = puntofijo, float g = ::gravity);
+    void cleanup();
+
+    // sets link i; call updateAcceleration() once all links are placed
+    void setLink(int i, float theta, float omega, float length, float m);
+    void updateAcceleration();
+
+    // steps the chain with any scheme of integrators.hpp; see ChainStepper
+    template<typename S>
+    void step(float DT);
+
+    int size() const { return (int)state.x.size(); }
+    float getAngle(int i) const { return state.x[i]; }
+    float getAngularVelocity(int i) const { return state.v[i]; }
+    float getLength(int i) const { return length[i]; }
+    float getMass(int i) const { return mass[i]; }
+    const glm::vec3 &getPivot() const { return pivot; }
+    const PhaseState<std::valarray<float> > &getState() const { return state; }
+
+    // the pivot followed by every bob, size() + 1 points
+    void getPositions(std::vector<glm::vec3> &points) const;
+    // kinetic plus potential energy, measured from the chain hanging at rest
+    float energy() const;
+    long long getEvaluations() const { return evaluations; }
+
+    // appends angles, angular velocities and accelerations, lengths and
+    // masses to values, for a checkpoint; loadState reads them back into a
+    // chain of the same size and returns the first value after them
+    void saveState(std::vector<float> &values) const;
+    const float *loadState(const float *values);
+
+    // angular accelerations at (theta, omega); uses scratch space of the
+    // chain, so one thread at a time
+    void accelerations(const std::valarray<float> &theta, const std::valarray<float> &omega,
+                       std::valarray<float> &alpha) const;
+    void accelerationsDense(const std::valarray<float> &theta, const std::valarray<float> &omega,
+                            std::valarray<float> &alpha) const;
+
+private:
+    glm::vec3 pivot;
+    float gravity;
+    std::vector<float> length, mass;
+    PhaseState<std::valarray<float> > state;
+    mutable long long evaluations;
+    // per-link sines and cosines, the tridiagonal system and the tensions
+    mutable std::vector<double> s, c, diag, off, rhs, tension;
+    // stage derivatives and the stage state of step()
+    std::valarray<float> kx[CHAIN_MAX_STAGES], kv[CHAIN_MAX_STAGES], xi, vi;
+
+    template<typename S> friend struct ChainStepper;
+};
+
+// force functor for the integrator policies; returns a new valarray per
+// evaluation, so step() only uses it for schemes without a ChainStepper
+struct ChainForce
+{
+    const PendulumChain *chain;
+
+    std::valarray<float> operator()(const std::valarray<float> &theta, const std::valarray<float> &omega) const
+    {
+        std::valarray<float> alpha(theta.size());
+        chain->accelerations(theta, omega, alpha);
+        return alpha;
+    }
+};
+
+// any other scheme, through ChainForce
+template<typename S>
+struct ChainStepper
+{
+    static void step(PendulumChain &chain, float DT)
+    {
+        ChainForce force = { &chain };
+        S::step(chain.state, DT, force);
+    }
+};
+
+// ExplicitRK<T>::step with the stages in the chain's buffers
+template<typename T>
+struct ChainStepper<ExplicitRK<T> >
+{
+    static_assert(T::stages <= CHAIN_MAX_STAGES, "raise CHAIN_MAX_STAGES");
+
+    static void step(PendulumChain &chain, float DT)
+    {
+        PhaseState<std::valarray<float> > &s = chain.state;
+        chain.kx[0] = s.v;
+        chain.kv[0] = s.a;
+        for (int i = 1; i < T::stages; ++i) {
+            chain.xi = s.x;
+            chain.vi = s.v;
+            for (int j = 0; j < i; ++j) {
+                if (T::a[i][j] != 0) {
+                    const float h = float(T::a[i][j]) * DT;
+                    chain.xi += chain.kx[j] * h;
+                    chain.vi += chain.kv[j] * h;
+                }
+            }
+            chain.kx[i] = chain.vi;
+            chain.accelerations(chain.xi, chain.vi, chain.kv[i]);
+        }
+        for (int i = 0; i < T::stages; ++i) {
+            if (T::b[i] != 0) {
+                const float h = float(T::b[i]) * DT;
+                s.x += chain.kx[i] * h;
+                s.v += chain.kv[i] * h;
+            }
+        }
+        chain.accelerations(s.x, s.v, s.a);
+    }
+};
+
+template<>
+struct ChainStepper<VelocityVerlet>
+{
+    static void step(PendulumChain &chain, float DT)
+    {
+        PhaseState<std::valarray<float> > &s = chain.state;
+        s.x += s.v * DT;
+        s.x += s.a * (0.5f * DT * DT);
+        chain.accelerations(s.x, s.v, chain.kv[0]);
+        s.v += (s.a + chain.kv[0]) * (0.5f * DT);
+        s.a = chain.kv[0];
+    }
+};
+
+// Composition<W>::step; kick-drift-kick needs no stage buffers at all
+template<typename W>
+struct ChainStepper<Composition<W> >
+{
+    static void step(PendulumChain &chain, float DT)
+    {
+        PhaseState<std::valarray<float> > &s = chain.state;
+        for (int i = 0; i < W::count; ++i) {
+            const float h = float(W::w[i]) * DT;
+            s.v += s.a * (0.5f * h);
+            s.x += s.v * h;
+            chain.accelerations(s.x, s.v, s.a);
+            s.v += s.a * (0.5f * h);
+        }
+    }
+};
+
+template<typename S>
+void PendulumChain::step(float DT)
+{
+    ChainStepper<S>::step(*this, DT);
+}
+
+#endif // CHAIN_H
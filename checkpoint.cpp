@@ -0,0 +1,186 @@
+#include "checkpoint.hpp"
+#include "physics.hpp"
+
+#include <cstring>
+
+static const int bodyFloats = 10;
+
+CheckpointHeader makeCheckpointHeader(float dt, int integrator, int substeps)
+{
+    CheckpointHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CKPT_MAGIC, sizeof(CKPT_MAGIC));
+    h.version = CKPT_VERSION;
+    h.headerSize = sizeof(CheckpointHeader);
+    h.integrator = integrator;
+    h.substeps = substeps;
+    h.gravity = gravity;
+    h.L = L;
+    h.R = R;
+    h.theta0 = theta0;
+    h.dt = dt;
+    h.puntofijo[0] = puntofijo.x;
+    h.puntofijo[1] = puntofijo.y;
+    h.puntofijo[2] = puntofijo.z;
+    return h;
+}
+
+CheckpointWriter::CheckpointWriter()
+{
+    snapshots = 0;
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    close();
+}
+
+bool CheckpointWriter::open(const char *path, const CheckpointHeader &h)
+{
+    close();
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    CheckpointHeader header = h;
+    header.headerSize = sizeof(CheckpointHeader);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.flush();
+    snapshots = 0;
+    return file.good();
+}
+
+bool CheckpointWriter::write(const Snapshot &s)
+{
+    SnapshotHeader sh;
+    memset(&sh, 0, sizeof(sh));
+    sh.time = s.time;
+    sh.step = s.step;
+    sh.bodyCount = (uint32_t)s.bodies.size();
+    sh.valueCount = (uint32_t)s.values.size();
+
+    buffer.clear();
+    for (size_t i = 0; i < s.bodies.size(); ++i) {
+        const Body &b = s.bodies[i];
+        glm::vec3 p = b.getPosition();
+        glm::vec3 v = b.getVelocity();
+        glm::vec3 a = b.getAcceleration();
+        float rec[bodyFloats] = { p.x, p.y, p.z, v.x, v.y, v.z, a.x, a.y, a.z, b.getMass() };
+        buffer.insert(buffer.end(), rec, rec + bodyFloats);
+    }
+    buffer.insert(buffer.end(), s.values.begin(), s.values.end());
+
+    file.write(reinterpret_cast<const char*>(&sh), sizeof(sh));
+    if (!buffer.empty()) {
+        file.write(reinterpret_cast<const char*>(&buffer[0]), buffer.size() * sizeof(float));
+    }
+    file.flush();
+    snapshots++;
+    return file.good();
+}
+
+void CheckpointWriter::close()
+{
+    if (file.is_open()) {
+        file.close();
+    }
+}
+
+CheckpointReader::CheckpointReader()
+{
+    memset(&header, 0, sizeof(header));
+}
+
+bool CheckpointReader::open(const char *path)
+{
+    close();
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    uint64_t length = file.tellg();
+    file.seekg(0);
+    if (length < sizeof(CheckpointHeader) ||
+        !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        memcmp(header.magic, CKPT_MAGIC, sizeof(CKPT_MAGIC)) != 0 || header.version != CKPT_VERSION ||
+        header.headerSize < sizeof(CheckpointHeader) || header.headerSize > length) {
+        close();
+        return false;
+    }
+
+    // walk the snapshot headers; a partial snapshot at the end is dropped
+    uint64_t offset = header.headerSize;
+    while (offset + sizeof(SnapshotHeader) <= length) {
+        SnapshotHeader sh;
+        file.seekg(offset);
+        if (!file.read(reinterpret_cast<char*>(&sh), sizeof(sh))) {
+            break;
+        }
+        uint64_t end = offset + sizeof(sh) + ((uint64_t)sh.bodyCount*bodyFloats + sh.valueCount)*sizeof(float);
+        if (end > length) {
+            break;
+        }
+        offsets.push_back(offset);
+        times.push_back(sh.time);
+        offset = end;
+    }
+    file.clear();
+    return true;
+}
+
+void CheckpointReader::close()
+{
+    if (file.is_open()) {
+        file.close();
+    }
+    file.clear();
+    memset(&header, 0, sizeof(header));
+    offsets.clear();
+    times.clear();
+}
+
+bool CheckpointReader::read(size_t i, Snapshot &s)
+{
+    if (i >= offsets.size()) {
+        return false;
+    }
+    SnapshotHeader sh;
+    file.seekg(offsets[i]);
+    if (!file.read(reinterpret_cast<char*>(&sh), sizeof(sh))) {
+        file.clear();
+        return false;
+    }
+    std::vector<float> rec((size_t)sh.bodyCount*bodyFloats);
+    s.time = sh.time;
+    s.step = sh.step;
+    s.values.resize(sh.valueCount);
+    if ((!rec.empty() && !file.read(reinterpret_cast<char*>(&rec[0]), rec.size()*sizeof(float))) ||
+        (!s.values.empty() && !file.read(reinterpret_cast<char*>(&s.values[0]), s.values.size()*sizeof(float)))) {
+        file.clear();
+        return false;
+    }
+    s.bodies.assign(sh.bodyCount, Body());
+    for (uint32_t b = 0; b < sh.bodyCount; ++b) {
+        const float *r = &rec[(size_t)b*bodyFloats];
+        s.bodies[b].setPosition(glm::vec3(r[0], r[1], r[2]));
+        s.bodies[b].setVelocity(glm::vec3(r[3], r[4], r[5]));
+        s.bodies[b].setAcceleration(glm::vec3(r[6], r[7], r[8]));
+        s.bodies[b].setMass(r[9]);
+    }
+    return true;
+}
+
+size_t CheckpointReader::findTime(double t) const
+{
+    size_t lo = 0, hi = times.size();
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (times[mid] <= t) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
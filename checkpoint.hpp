@@ -0,0 +1,108 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+#include "body.hpp"
+
+// Binary checkpoint file: one CheckpointHeader with the configuration of the
+// run, followed by snapshots taken at intervals. Each snapshot is a
+// SnapshotHeader, bodyCount bodies of 10 floats (position, velocity,
+// acceleration, mass) and valueCount floats of integrator state (angles,
+// ensemble and chain arrays) in an order fixed by the program that wrote
+// it. Values are stored as they are in memory, so a restored run continues
+// bit for bit like the original. A snapshot cut short by a crash at the end
+// of the file is ignored.
+
+#define CKPT_MAGIC "PNDCKPT"
+#define CKPT_VERSION 1
+
+// flags
+#define CKPT_CARTESIAN 1u   // the pendulum was integrated in x/z, not in angle space
+#define CKPT_CHECK_BC 2u    // CheckBC ran after every step
+
+struct CheckpointHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    int32_t integrator;
+    int32_t substeps;
+    uint32_t flags;
+    int32_t bodyCount;
+    int32_t ensembleSize;
+    int32_t chainLinks;
+    float gravity;
+    float L;
+    float R;
+    float theta0;
+    float dt;               // one physics step; each is substeps integrator calls
+    float puntofijo[3];
+    uint32_t reserved[14];
+};
+
+struct SnapshotHeader
+{
+    double time;
+    int64_t step;
+    uint32_t bodyCount;
+    uint32_t valueCount;
+    uint32_t reserved[2];
+};
+
+static_assert(sizeof(CheckpointHeader) == 128, "CheckpointHeader layout changed");
+static_assert(sizeof(SnapshotHeader) == 32, "SnapshotHeader layout changed");
+
+// fills a header with the compile-time parameters from physics.hpp
+CheckpointHeader makeCheckpointHeader(float dt, int integrator, int substeps);
+
+struct Snapshot
+{
+    double time;
+    long long step;
+    std::vector<Body> bodies;
+    std::vector<float> values;
+};
+
+class CheckpointWriter
+{
+public:
+    CheckpointWriter();
+    ~CheckpointWriter();
+    bool open(const char *path, const CheckpointHeader &header);
+    // writes and flushes one snapshot, so it survives the program dying
+    bool write(const Snapshot &snapshot);
+    void close();
+    bool isOpen() const { return file.is_open(); }
+    long long getSnapshots() const { return snapshots; }
+
+private:
+    std::ofstream file;
+    std::vector<float> buffer;
+    long long snapshots;
+};
+
+// Reads the header and indexes the snapshots on open(); a snapshot is only
+// read from disk when asked for.
+class CheckpointReader
+{
+public:
+    CheckpointReader();
+    bool open(const char *path);
+    void close();
+    const CheckpointHeader &getHeader() const { return header; }
+    size_t size() const { return offsets.size(); }
+    double getTime(size_t i) const { return times[i]; }
+    bool read(size_t i, Snapshot &snapshot);
+    // index of the last snapshot with time <= t, or 0
+    size_t findTime(double t) const;
+
+private:
+    std::ifstream file;
+    CheckpointHeader header;
+    std::vector<uint64_t> offsets;
+    std::vector<double> times;
+};
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,152 @@
+#include "collision.hpp"
+#include "physics.hpp"
+
+#include <cmath>
+
+// cell coordinates are kept in 21 bits each, centred on zero
+static const int64_t keyBias = 1 << 20;
+static const uint64_t keyMask = (1 << 21) - 1;
+
+SpatialHash::SpatialHash()
+{
+    cellSize = 2*R;
+}
+
+void SpatialHash::init(float size)
+{
+    cleanup();
+    cellSize = size;
+}
+
+void SpatialHash::cleanup()
+{
+    cells.clear();
+    bodyCell.clear();
+    bodySlot.clear();
+}
+
+uint64_t SpatialHash::packKey(int64_t x, int64_t y, int64_t z)
+{
+    return ((uint64_t)(x + keyBias) & keyMask) << 42 |
+           ((uint64_t)(y + keyBias) & keyMask) << 21 |
+           ((uint64_t)(z + keyBias) & keyMask);
+}
+
+uint64_t SpatialHash::cellKey(const glm::vec3 &p) const
+{
+    return packKey((int64_t)std::floor(p.x / cellSize),
+                   (int64_t)std::floor(p.y / cellSize),
+                   (int64_t)std::floor(p.z / cellSize));
+}
+
+void SpatialHash::insert(int body, uint64_t key)
+{
+    std::vector<int> &cell = cells[key];
+    bodyCell[body] = key;
+    bodySlot[body] = (int)cell.size();
+    cell.push_back(body);
+}
+
+void SpatialHash::remove(int body)
+{
+    std::unordered_map<uint64_t, std::vector<int> >::iterator it = cells.find(bodyCell[body]);
+    std::vector<int> &cell = it->second;
+    int last = cell.back();
+    cell[bodySlot[body]] = last;
+    bodySlot[last] = bodySlot[body];
+    cell.pop_back();
+    if (cell.empty()) {
+        cells.erase(it);
+    }
+}
+
+void SpatialHash::update(const std::vector<Body> &bodies)
+{
+    if (bodies.size() != bodyCell.size()) {
+        // body count changed, start over
+        cells.clear();
+        bodyCell.assign(bodies.size(), 0);
+        bodySlot.assign(bodies.size(), 0);
+        for (size_t i = 0; i < bodies.size(); ++i) {
+            insert((int)i, cellKey(bodies[i].getPosition()));
+        }
+        return;
+    }
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        uint64_t key = cellKey(bodies[i].getPosition());
+        if (key != bodyCell[i]) {
+            remove((int)i);
+            insert((int)i, key);
+        }
+    }
+}
+
+void SpatialHash::findPairs(std::vector<std::pair<int, int> > &pairs) const
+{
+    // half of the 26 neighbours, so each pair of cells is visited once
+    static const int forward[13][3] = {
+        {1,0,0}, {-1,1,0}, {0,1,0}, {1,1,0},
+        {-1,-1,1}, {0,-1,1}, {1,-1,1}, {-1,0,1}, {0,0,1}, {1,0,1}, {-1,1,1}, {0,1,1}, {1,1,1}
+    };
+
+    pairs.clear();
+    std::unordered_map<uint64_t, std::vector<int> >::const_iterator it;
+    for (it = cells.begin(); it != cells.end(); ++it) {
+        const std::vector<int> &cell = it->second;
+        for (size_t a = 0; a < cell.size(); ++a) {
+            for (size_t b = a + 1; b < cell.size(); ++b) {
+                int i = cell[a], j = cell[b];
+                pairs.push_back(i < j ? std::make_pair(i, j) : std::make_pair(j, i));
+            }
+        }
+
+        int64_t x = (int64_t)((it->first >> 42) & keyMask) - keyBias;
+        int64_t y = (int64_t)((it->first >> 21) & keyMask) - keyBias;
+        int64_t z = (int64_t)(it->first & keyMask) - keyBias;
+        for (int n = 0; n < 13; ++n) {
+            std::unordered_map<uint64_t, std::vector<int> >::const_iterator other =
+                cells.find(packKey(x + forward[n][0], y + forward[n][1], z + forward[n][2]));
+            if (other == cells.end()) {
+                continue;
+            }
+            for (size_t a = 0; a < cell.size(); ++a) {
+                for (size_t b = 0; b < other->second.size(); ++b) {
+                    int i = cell[a], j = other->second[b];
+                    pairs.push_back(i < j ? std::make_pair(i, j) : std::make_pair(j, i));
+                }
+            }
+        }
+    }
+}
+
+bool CollideSpheres(Body &a, Body &b)
+{
+    glm::vec3 d = b.getPosition() - a.getPosition();
+    float dist2 = glm::dot(d, d);
+    if (dist2 >= 4*R*R || dist2 <= 0.0f) {
+        return false;
+    }
+    glm::vec3 n = d/std::sqrt(dist2);
+    float u = glm::dot(b.getVelocity() - a.getVelocity(), n);
+    if (u >= 0.0f) {
+        return false;
+    }
+    float ima = 1.0f/a.getMass(), imb = 1.0f/b.getMass();
+    float j = -2.0f*u/(ima + imb);
+    a.setVelocity(a.getVelocity() - n*(j*ima));
+    b.setVelocity(b.getVelocity() + n*(j*imb));
+    return true;
+}
+
+int CollideAll(std::vector<Body> &bodies, SpatialHash &grid, std::vector<std::pair<int, int> > &pairs)
+{
+    grid.update(bodies);
+    grid.findPairs(pairs);
+    int bounced = 0;
+    for (size_t k = 0; k < pairs.size(); ++k) {
+        if (CollideSpheres(bodies[pairs[k].first], bodies[pairs[k].second])) {
+            ++bounced;
+        }
+    }
+    return bounced;
+}
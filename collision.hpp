@@ -0,0 +1,48 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "body.hpp"
+
+// Broad phase for sphere-sphere collisions: bodies are binned in a uniform
+// grid stored in a hash map, so only bodies in neighbouring cells become
+// candidate pairs. With cells at least one sphere diameter wide, every
+// overlapping pair is found. update() only re-bins bodies whose cell changed
+// since the previous call.
+class SpatialHash
+{
+public:
+    SpatialHash();
+    void init(float cellSize);
+    void cleanup();
+
+    void update(const std::vector<Body> &bodies);
+    // candidate pairs (i < j) from each cell and its 13 forward neighbours
+    void findPairs(std::vector<std::pair<int, int> > &pairs) const;
+
+private:
+    uint64_t cellKey(const glm::vec3 &p) const;
+    static uint64_t packKey(int64_t x, int64_t y, int64_t z);
+    void insert(int body, uint64_t key);
+    void remove(int body);
+
+    float cellSize;
+    std::unordered_map<uint64_t, std::vector<int> > cells;
+    std::vector<uint64_t> bodyCell;   // key of the cell each body is in
+    std::vector<int> bodySlot;        // index of the body inside that cell
+};
+
+// Narrow phase for two spheres of radius R (physics.hpp): if they overlap
+// and approach each other, applies the mass-weighted elastic impulse along
+// the unit line of centres and returns true. Separating pairs are left
+// alone, so a pair that stays overlapped for several steps bounces once.
+bool CollideSpheres(Body &a, Body &b);
+
+// runs the broad phase and hands every candidate pair to CollideSpheres();
+// returns the number of pairs that bounced
+int CollideAll(std::vector<Body> &bodies, SpatialHash &grid, std::vector<std::pair<int, int> > &pairs);
+
+#endif // COLLISION_H
@@ -0,0 +1,261 @@
+#include "container.hpp"
+#include "simd.hpp"
+
+#include <new>
+#include <limits>
+#include <algorithm>
+
+static float *allocArray(int n)
+{
+    return static_cast<float*>(::operator new[](n * sizeof(float), std::align_val_t(SIMD_ALIGN)));
+}
+
+static void freeArray(float *p)
+{
+    if (p) {
+        ::operator delete[](p, std::align_val_t(SIMD_ALIGN));
+    }
+}
+
+BodyArrays::BodyArrays()
+{
+    count = 0;
+    capacity = 0;
+    x = y = z = vx = vy = vz = 0;
+}
+
+BodyArrays::~BodyArrays()
+{
+    cleanup();
+}
+
+void BodyArrays::init(int n)
+{
+    cleanup();
+    count = n;
+    capacity = (n + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    x = allocArray(capacity);
+    y = allocArray(capacity);
+    z = allocArray(capacity);
+    vx = allocArray(capacity);
+    vy = allocArray(capacity);
+    vz = allocArray(capacity);
+    // padding bodies sit at the origin at rest; they may be moved by the
+    // kernel but are never stored back
+    for (int i = 0; i < capacity; ++i) {
+        x[i] = y[i] = z[i] = vx[i] = vy[i] = vz[i] = 0.0f;
+    }
+}
+
+void BodyArrays::cleanup()
+{
+    freeArray(x);
+    freeArray(y);
+    freeArray(z);
+    freeArray(vx);
+    freeArray(vy);
+    freeArray(vz);
+    x = y = z = vx = vy = vz = 0;
+    count = 0;
+    capacity = 0;
+}
+
+void BodyArrays::load(const std::vector<Body> &bodies)
+{
+    if ((int)bodies.size() != count) {
+        init((int)bodies.size());
+    }
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 p = bodies[i].getPosition();
+        glm::vec3 v = bodies[i].getVelocity();
+        x[i] = p.x;
+        y[i] = p.y;
+        z[i] = p.z;
+        vx[i] = v.x;
+        vy[i] = v.y;
+        vz[i] = v.z;
+    }
+}
+
+void BodyArrays::store(std::vector<Body> &bodies) const
+{
+    for (int i = 0; i < count && i < (int)bodies.size(); ++i) {
+        bodies[i].setPosition(glm::vec3(x[i], y[i], z[i]));
+        bodies[i].setVelocity(glm::vec3(vx[i], vy[i], vz[i]));
+    }
+}
+
+Container::Container()
+{
+    isBox = false;
+    boxRestitution = 1.0f;
+}
+
+void Container::clear()
+{
+    planes.clear();
+    isBox = false;
+}
+
+void Container::addPlane(const glm::vec3 &normal, float offset, float restitution)
+{
+    pushPlane(normal, offset, restitution);
+    isBox = false;
+}
+
+void Container::pushPlane(const glm::vec3 &normal, float offset, float restitution)
+{
+    float len = glm::length(normal);
+    ContainerPlane p;
+    p.normal = normal / len;
+    p.offset = offset;
+    p.restitution = restitution;
+    planes.push_back(p);
+}
+
+void Container::addBox(const glm::vec3 &lo, const glm::vec3 &hi, float restitution, bool openTop)
+{
+    bool first = planes.empty();
+    pushPlane(glm::vec3(0.0f, 0.0f, 1.0f), lo.z, restitution);
+    pushPlane(glm::vec3(1.0f, 0.0f, 0.0f), lo.x, restitution);
+    pushPlane(glm::vec3(-1.0f, 0.0f, 0.0f), -hi.x, restitution);
+    pushPlane(glm::vec3(0.0f, 1.0f, 0.0f), lo.y, restitution);
+    pushPlane(glm::vec3(0.0f, -1.0f, 0.0f), -hi.y, restitution);
+    if (!openTop) {
+        pushPlane(glm::vec3(0.0f, 0.0f, -1.0f), -hi.z, restitution);
+    }
+    isBox = first;
+    boxLo = lo;
+    boxHi = hi;
+    if (openTop) {
+        boxHi.z = std::numeric_limits<float>::infinity();
+    }
+    boxRestitution = restitution;
+}
+
+// One axis of the box: clamp into [lo, hi] and, on the side that was crossed,
+// turn velocity into the wall into -e times itself. With e >= 0, max(v, -e*v)
+// is -e*v when v < 0 and v otherwise, and min(v, -e*v) the reverse.
+static inline void boxAxis(float &p, float &v, float lo, float hi, float e)
+{
+    bool below = p < lo;
+    bool above = p > hi;
+    p = std::min(std::max(p, lo), hi);
+    v = below ? std::max(v, -e*v) : v;
+    v = above ? std::min(v, -e*v) : v;
+}
+
+static inline void boxAxis(vfloat &p, vfloat &v, vfloat lo, vfloat hi, vfloat e)
+{
+    vmask below = p < lo;
+    vmask above = p > hi;
+    p = vmin(vmax(p, lo), hi);
+    vfloat ev = -(e*v);
+    v = vselect(below, vmax(v, ev), v);
+    v = vselect(above, vmin(v, ev), v);
+}
+
+// Per plane: d = n.p - offset - r is negative when the body crosses it.
+// The position moves back along n by -min(d, 0), and where d < 0 the normal
+// velocity into the wall, min(n.v, 0), is replaced by -e times itself.
+void Container::collide(Body &body, float radius) const
+{
+    glm::vec3 p = body.getPosition();
+    glm::vec3 v = body.getVelocity();
+    if (isBox) {
+        boxAxis(p.x, v.x, boxLo.x + radius, boxHi.x - radius, boxRestitution);
+        boxAxis(p.y, v.y, boxLo.y + radius, boxHi.y - radius, boxRestitution);
+        boxAxis(p.z, v.z, boxLo.z + radius, boxHi.z - radius, boxRestitution);
+        body.setPosition(p);
+        body.setVelocity(v);
+        return;
+    }
+    bool moved = false;
+    for (const ContainerPlane &pl : planes) {
+        const glm::vec3 &nrm = pl.normal;
+        float d = nrm.x*p.x + nrm.y*p.y + nrm.z*p.z - pl.offset - radius;
+        if (d < 0.0f) {
+            float vn = std::min(nrm.x*v.x + nrm.y*v.y + nrm.z*v.z, 0.0f);
+            float impulse = -(1.0f + pl.restitution) * vn;
+            p.x -= nrm.x*d;
+            p.y -= nrm.y*d;
+            p.z -= nrm.z*d;
+            v.x += nrm.x*impulse;
+            v.y += nrm.y*impulse;
+            v.z += nrm.z*impulse;
+            moved = true;
+        }
+    }
+    // most bodies touch no wall; skip the write-back for them
+    if (moved) {
+        body.setPosition(p);
+        body.setVelocity(v);
+    }
+}
+
+void Container::collide(BodyArrays &b, float radius) const
+{
+    if (isBox) {
+        vfloat lox = vset(boxLo.x + radius), hix = vset(boxHi.x - radius);
+        vfloat loy = vset(boxLo.y + radius), hiy = vset(boxHi.y - radius);
+        vfloat loz = vset(boxLo.z + radius), hiz = vset(boxHi.z - radius);
+        vfloat e = vset(boxRestitution);
+        for (int i = 0; i < b.paddedSize(); i += SIMD_WIDTH) {
+            vfloat p = vload(b.x+i), v = vload(b.vx+i);
+            boxAxis(p, v, lox, hix, e);
+            vstore(b.x+i, p);
+            vstore(b.vx+i, v);
+            p = vload(b.y+i);
+            v = vload(b.vy+i);
+            boxAxis(p, v, loy, hiy, e);
+            vstore(b.y+i, p);
+            vstore(b.vy+i, v);
+            p = vload(b.z+i);
+            v = vload(b.vz+i);
+            boxAxis(p, v, loz, hiz, e);
+            vstore(b.z+i, p);
+            vstore(b.vz+i, v);
+        }
+        return;
+    }
+
+    const int n = (int)planes.size();
+    const vfloat zero = vset(0.0f);
+    for (int i = 0; i < b.paddedSize(); i += SIMD_WIDTH) {
+        vfloat px = vload(b.x+i), py = vload(b.y+i), pz = vload(b.z+i);
+        vfloat vx = vload(b.vx+i), vy = vload(b.vy+i), vz = vload(b.vz+i);
+        for (int k = 0; k < n; ++k) {
+            const ContainerPlane &pl = planes[k];
+            vfloat nx = vset(pl.normal.x), ny = vset(pl.normal.y), nz = vset(pl.normal.z);
+            vfloat d = vfmadd(nx, px, vfmadd(ny, py, nz*pz)) - vset(pl.offset + radius);
+            vfloat vn = vmin(vfmadd(nx, vx, vfmadd(ny, vy, nz*vz)), zero);
+            vfloat impulse = vselect(d < zero, vset(-(1.0f + pl.restitution)) * vn, zero);
+            vfloat push = vmin(d, zero);
+            px = px - nx*push;
+            py = py - ny*push;
+            pz = pz - nz*push;
+            vx = vfmadd(nx, impulse, vx);
+            vy = vfmadd(ny, impulse, vy);
+            vz = vfmadd(nz, impulse, vz);
+        }
+        vstore(b.x+i, px);
+        vstore(b.y+i, py);
+        vstore(b.z+i, pz);
+        vstore(b.vx+i, vx);
+        vstore(b.vy+i, vy);
+        vstore(b.vz+i, vz);
+    }
+}
+
+static Container makeDefaultContainer()
+{
+    Container c;
+    c.addBox(glm::vec3(-2.0f, -2.0f, 0.0f), glm::vec3(2.0f, 2.0f, 0.0f), 1.0f, true);
+    return c;
+}
+
+const Container &defaultContainer()
+{
+    static const Container box = makeDefaultContainer();
+    return box;
+}
@@ -0,0 +1,82 @@
+#ifndef CONTAINER_H
+#define CONTAINER_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "body.hpp"
+
+// A wall of a container: points p with dot(normal, p) >= offset are inside.
+// restitution is the fraction of the normal speed kept after a bounce
+// (1 elastic, 0 the body stops against the wall).
+struct ContainerPlane
+{
+    glm::vec3 normal;
+    float offset;
+    float restitution;
+};
+
+// Free bodies stored as structure-of-arrays for the batched container
+// kernel, padded to a multiple of SIMD_WIDTH like Ensemble, and like it
+// not copyable.
+class BodyArrays
+{
+public:
+    BodyArrays();
+    ~BodyArrays();
+    BodyArrays(const BodyArrays&) = delete;
+    BodyArrays& operator=(const BodyArrays&) = delete;
+    void init(int n);
+    void cleanup();
+
+    void load(const std::vector<Body> &bodies);
+    // writes positions and velocities back; accelerations and masses are left alone
+    void store(std::vector<Body> &bodies) const;
+    int size() const { return count; }
+    int paddedSize() const { return capacity; }
+
+    float *x, *y, *z, *vx, *vy, *vz;
+
+private:
+    int count, capacity;
+};
+
+// A container described as a list of planes. Bodies of radius r are pushed
+// back inside every plane they cross and their normal velocity is reflected
+// and scaled by the plane's restitution. Only velocity into the wall is
+// reflected, so a body already moving away is left alone. Planes are applied
+// in the order they were added.
+//
+// A container built from a single addBox() call is also kept as an AABB and
+// collided axis by axis with min/max clamps, which is shorter than the
+// general plane loop and has no dependency between the axes.
+class Container
+{
+public:
+    Container();
+    void clear();
+
+    // normal need not be unit length; offset is measured along the unit normal
+    void addPlane(const glm::vec3 &normal, float offset, float restitution = 1.0f);
+    // the six inner faces of the box [lo, hi], or five without the top face
+    void addBox(const glm::vec3 &lo, const glm::vec3 &hi, float restitution = 1.0f, bool openTop = false);
+
+    int size() const { return (int)planes.size(); }
+    const ContainerPlane &plane(int i) const { return planes[i]; }
+
+    void collide(Body &body, float radius) const;
+    // branchless SIMD kernel over every body of the arrays
+    void collide(BodyArrays &bodies, float radius) const;
+
+private:
+    void pushPlane(const glm::vec3 &normal, float offset, float restitution);
+
+    std::vector<ContainerPlane> planes;
+    bool isBox;
+    glm::vec3 boxLo, boxHi;   // hi.z is +inf for an open top
+    float boxRestitution;
+};
+
+// floor at z = 0 and walls at x, y = +-2, open at the top; what CheckBC() uses
+const Container &defaultContainer();
+
+#endif // CONTAINER_H
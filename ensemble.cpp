@@ -0,0 +1,284 @@
+#include "ensemble.hpp"
+#include "simd.hpp"
+#include "fastmath.hpp"
+#include "physics.hpp"
+
+#include <new>
+#include <algorithm>
+#include <cmath>
+
+static float *allocArray(int n)
+{
+    return static_cast<float*>(::operator new[](n * sizeof(float), std::align_val_t(SIMD_ALIGN)));
+}
+
+static void freeArray(float *p)
+{
+    if (p) {
+        ::operator delete[](p, std::align_val_t(SIMD_ALIGN));
+    }
+}
+
+// Same force model as updateAcceleration() in physics.cpp, with sin(theta)
+// and cos(theta) taken from the rod direction instead of atan/sin/cos:
+// sin = dx/|r|, cos = -dz/|r|, and L*thetavel^2 = |v|^2/L.
+static inline void acceleration(vfloat x, vfloat z, vfloat vx, vfloat vz, vfloat len,
+                                vfloat px, vfloat pz, vfloat g, vfloat &ax, vfloat &az)
+{
+    vfloat dx = x - px;
+    vfloat dz = z - pz;
+    vfloat rinv = vset(1.0f) / vsqrt(dx*dx + dz*dz);
+    vfloat s = dx * rinv;
+    vfloat c = -(dz * rinv);
+    vfloat fn = -((vx*vx + vz*vz) / len);   // normal force per unit mass
+    vfloat ft = -(g * s);                   // tangential force per unit mass
+    ax = fn*s + ft*c;
+    az = ft*s - fn*c;
+}
+
+// sin of every lane through libm, for runs without the fast polynomials
+static inline vfloat libmSin(vfloat a)
+{
+    alignas(SIMD_ALIGN) float lanes[SIMD_WIDTH];
+    vstore(lanes, a);
+    for (int k = 0; k < SIMD_WIDTH; ++k) {
+        lanes[k] = std::sin(lanes[k]);
+    }
+    return vload(lanes);
+}
+
+template<bool Fast>
+static inline vfloat angularAcceleration(vfloat th, vfloat gOverL)
+{
+    return -(gOverL * (Fast ? vsin(th) : libmSin(th)));
+}
+
+Ensemble::Ensemble()
+{
+    count = 0;
+    capacity = 0;
+    gravity = 0.0f;
+    x = z = vx = vz = ax = az = mass = L = 0;
+    theta = omega = 0;
+}
+
+Ensemble::~Ensemble()
+{
+    cleanup();
+}
+
+void Ensemble::init(int n, const glm::vec3& p, float g)
+{
+    cleanup();
+    count = n;
+    capacity = (n + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    pivot = p;
+    gravity = g;
+
+    x = allocArray(capacity);
+    z = allocArray(capacity);
+    vx = allocArray(capacity);
+    vz = allocArray(capacity);
+    ax = allocArray(capacity);
+    az = allocArray(capacity);
+    mass = allocArray(capacity);
+    L = allocArray(capacity);
+    theta = allocArray(capacity);
+    omega = allocArray(capacity);
+    for (int i = 0; i < capacity; ++i) {
+        setPendulum(i, 0.0f, 0.0f, 1.0f, 1.0f);
+    }
+}
+
+void Ensemble::cleanup()
+{
+    freeArray(x);
+    freeArray(z);
+    freeArray(vx);
+    freeArray(vz);
+    freeArray(ax);
+    freeArray(az);
+    freeArray(mass);
+    freeArray(L);
+    freeArray(theta);
+    freeArray(omega);
+    x = z = vx = vz = ax = az = mass = L = 0;
+    theta = omega = 0;
+    count = 0;
+    capacity = 0;
+}
+
+void Ensemble::setPendulum(int i, float th, float om, float length, float m)
+{
+    float s = glm::sin(th);
+    float c = glm::cos(th);
+    x[i] = pivot.x + length*s;
+    z[i] = pivot.z - length*c;
+    vx[i] = length*om*c;
+    vz[i] = length*om*s;
+    L[i] = length;
+    mass[i] = m;
+    theta[i] = th;
+    omega[i] = om;
+
+    float fn = -length*om*om;
+    float ft = -gravity*s;
+    ax[i] = fn*s + ft*c;
+    az[i] = ft*s - fn*c;
+}
+
+void Ensemble::saveState(std::vector<float> &values) const
+{
+    const float *arrays[] = { x, z, vx, vz, ax, az, mass, L, theta, omega };
+    for (const float *a : arrays) {
+        values.insert(values.end(), a, a + count);
+    }
+}
+
+const float *Ensemble::loadState(const float *values)
+{
+    float *arrays[] = { x, z, vx, vz, ax, az, mass, L, theta, omega };
+    for (float *a : arrays) {
+        std::copy(values, values + count, a);
+        values += count;
+    }
+    return values;
+}
+
+void Ensemble::updateAcceleration()
+{
+    vfloat px = vset(pivot.x), pz = vset(pivot.z), g = vset(gravity);
+    for (int i = 0; i < capacity; i += SIMD_WIDTH) {
+        vfloat vax, vaz;
+        acceleration(vload(x+i), vload(z+i), vload(vx+i), vload(vz+i), vload(L+i), px, pz, g, vax, vaz);
+        vstore(ax+i, vax);
+        vstore(az+i, vaz);
+    }
+}
+
+// velocity Verlet, matching IntegrateVerlet() for a single Body
+void Ensemble::IntegrateVerlet(float DT)
+{
+    vfloat px = vset(pivot.x), pz = vset(pivot.z), g = vset(gravity);
+    vfloat dt = vset(DT), halfdt = vset(0.5f*DT), halfdt2 = vset(0.5f*DT*DT);
+    for (int i = 0; i < capacity; i += SIMD_WIDTH) {
+        vfloat cx = vload(x+i), cz = vload(z+i);
+        vfloat cvx = vload(vx+i), cvz = vload(vz+i);
+        vfloat cax = vload(ax+i), caz = vload(az+i);
+
+        cx = vfmadd(cax, halfdt2, vfmadd(cvx, dt, cx));
+        cz = vfmadd(caz, halfdt2, vfmadd(cvz, dt, cz));
+        vfloat nax, naz;
+        acceleration(cx, cz, cvx, cvz, vload(L+i), px, pz, g, nax, naz);
+        cvx = vfmadd(cax + nax, halfdt, cvx);
+        cvz = vfmadd(caz + naz, halfdt, cvz);
+
+        vstore(x+i, cx);
+        vstore(z+i, cz);
+        vstore(vx+i, cvx);
+        vstore(vz+i, cvz);
+        vstore(ax+i, nax);
+        vstore(az+i, naz);
+    }
+}
+
+// classic RK4 on (x, z, vx, vz), each stage evaluated at its own estimate.
+// The first stage reuses the stored acceleration, which every step leaves
+// evaluated at the new state, so a step costs four force evaluations.
+void Ensemble::IntegrateRK4(float DT)
+{
+    vfloat px = vset(pivot.x), pz = vset(pivot.z), g = vset(gravity);
+    vfloat dt = vset(DT), halfdt = vset(0.5f*DT), sixthdt = vset(DT/6.0f), two = vset(2.0f);
+    for (int i = 0; i < capacity; i += SIMD_WIDTH) {
+        vfloat len = vload(L+i);
+        vfloat x1 = vload(x+i), z1 = vload(z+i);
+        vfloat vx1 = vload(vx+i), vz1 = vload(vz+i);
+        vfloat ax1 = vload(ax+i), az1 = vload(az+i);
+        vfloat ax2, az2, ax3, az3, ax4, az4;
+
+        vfloat x2 = vfmadd(vx1, halfdt, x1), z2 = vfmadd(vz1, halfdt, z1);
+        vfloat vx2 = vfmadd(ax1, halfdt, vx1), vz2 = vfmadd(az1, halfdt, vz1);
+        acceleration(x2, z2, vx2, vz2, len, px, pz, g, ax2, az2);
+
+        vfloat x3 = vfmadd(vx2, halfdt, x1), z3 = vfmadd(vz2, halfdt, z1);
+        vfloat vx3 = vfmadd(ax2, halfdt, vx1), vz3 = vfmadd(az2, halfdt, vz1);
+        acceleration(x3, z3, vx3, vz3, len, px, pz, g, ax3, az3);
+
+        vfloat x4 = vfmadd(vx3, dt, x1), z4 = vfmadd(vz3, dt, z1);
+        vfloat vx4 = vfmadd(ax3, dt, vx1), vz4 = vfmadd(az3, dt, vz1);
+        acceleration(x4, z4, vx4, vz4, len, px, pz, g, ax4, az4);
+
+        vfloat nx = vfmadd(vx1 + two*(vx2 + vx3) + vx4, sixthdt, x1);
+        vfloat nz = vfmadd(vz1 + two*(vz2 + vz3) + vz4, sixthdt, z1);
+        vfloat nvx = vfmadd(ax1 + two*(ax2 + ax3) + ax4, sixthdt, vx1);
+        vfloat nvz = vfmadd(az1 + two*(az2 + az3) + az4, sixthdt, vz1);
+
+        vstore(x+i, nx);
+        vstore(z+i, nz);
+        vstore(vx+i, nvx);
+        vstore(vz+i, nvz);
+        vfloat nax, naz;
+        acceleration(nx, nz, nvx, nvz, len, px, pz, g, nax, naz);
+        vstore(ax+i, nax);
+        vstore(az+i, naz);
+    }
+}
+
+template<bool Fast>
+static void angleRK4(int capacity, float DT, float gravity, const glm::vec3 &pivot, const float *L,
+                     float *theta, float *omega, float *x, float *z, float *vx, float *vz, float *ax, float *az)
+{
+    vfloat g = vset(gravity), px = vset(pivot.x), pz = vset(pivot.z);
+    vfloat dt = vset(DT), halfdt = vset(0.5f*DT), sixthdt = vset(DT/6.0f), two = vset(2.0f);
+    for (int i = 0; i < capacity; i += SIMD_WIDTH) {
+        vfloat len = vload(L+i);
+        vfloat gOverL = g / len;
+        vfloat th1 = vload(theta+i), om1 = vload(omega+i);
+        vfloat al1 = angularAcceleration<Fast>(th1, gOverL);
+
+        vfloat th2 = vfmadd(om1, halfdt, th1), om2 = vfmadd(al1, halfdt, om1);
+        vfloat al2 = angularAcceleration<Fast>(th2, gOverL);
+        vfloat th3 = vfmadd(om2, halfdt, th1), om3 = vfmadd(al2, halfdt, om1);
+        vfloat al3 = angularAcceleration<Fast>(th3, gOverL);
+        vfloat th4 = vfmadd(om3, dt, th1), om4 = vfmadd(al3, dt, om1);
+        vfloat al4 = angularAcceleration<Fast>(th4, gOverL);
+
+        vfloat nth = vfmadd(om1 + two*(om2 + om3) + om4, sixthdt, th1);
+        vfloat nom = vfmadd(al1 + two*(al2 + al3) + al4, sixthdt, om1);
+        vstore(theta+i, nth);
+        vstore(omega+i, nom);
+
+        // Cartesian state on the circle, as setPendulum builds it
+        vfloat s, c;
+        if (Fast) {
+            vsincos(nth, s, c);
+        } else {
+            alignas(SIMD_ALIGN) float ls[SIMD_WIDTH], lc[SIMD_WIDTH];
+            vstore(ls, nth);
+            for (int k = 0; k < SIMD_WIDTH; ++k) {
+                lc[k] = std::cos(ls[k]);
+                ls[k] = std::sin(ls[k]);
+            }
+            s = vload(ls);
+            c = vload(lc);
+        }
+        vfloat lom = len * nom;
+        vfloat fn = -(lom * nom);
+        vfloat ft = -(g * s);
+        vstore(x+i, vfmadd(len, s, px));
+        vstore(z+i, pz - len*c);
+        vstore(vx+i, lom * c);
+        vstore(vz+i, lom * s);
+        vstore(ax+i, fn*s + ft*c);
+        vstore(az+i, ft*s - fn*c);
+    }
+}
+
+void Ensemble::IntegrateAngleRK4(float DT)
+{
+    if (getFastTrig()) {
+        angleRK4<true>(capacity, DT, gravity, pivot, L, theta, omega, x, z, vx, vz, ax, az);
+    } else {
+        angleRK4<false>(capacity, DT, gravity, pivot, L, theta, omega, x, z, vx, vz, ax, az);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+// N independent planar pendulums hanging from a common pivot, stored as
+// structure-of-arrays so the integrators step SIMD_WIDTH pendulums per
+// instruction. Positions are absolute (x,z) like Body; y is always 0.
+// Arrays are padded to a multiple of the SIMD width with pendulums at rest.
+// The arrays are owned, so an ensemble cannot be copied.
+class Ensemble
+{
+public:
+    Ensemble();
+    ~Ensemble();
+    Ensemble(const Ensemble&) = delete;
+    Ensemble& operator=(const Ensemble&) = delete;
+    void init(int n, const glm::vec3& pivot, float g);
+    void cleanup();
+
+    // places pendulum i at angle theta with angular velocity omega
+    void setPendulum(int i, float theta, float omega, float length, float m);
+    glm::vec3 getPosition(int i) const { return glm::vec3(x[i], 0.0f, z[i]); }
+    glm::vec3 getVelocity(int i) const { return glm::vec3(vx[i], 0.0f, vz[i]); }
+    glm::vec3 getAcceleration(int i) const { return glm::vec3(ax[i], 0.0f, az[i]); }
+    float getMass(int i) const { return mass[i]; }
+    float getLength(int i) const { return L[i]; }
+    int size() const { return count; }
+
+    // appends every array of the first size() pendulums to values, for a
+    // checkpoint; loadState reads them back from an ensemble of the same size
+    // and returns the first value after them
+    void saveState(std::vector<float> &values) const;
+    const float *loadState(const float *values);
+
+    void updateAcceleration();
+    void IntegrateVerlet(float DT);
+    void IntegrateRK4(float DT);
+    // RK4 on the angle and angular velocity instead of x/z; the Cartesian
+    // arrays are rebuilt from the new angles after each step. Angles are
+    // only advanced here, so step an ensemble with one family or the other.
+    // Uses the fastmath.hpp polynomials when getFastTrig() is set.
+    void IntegrateAngleRK4(float DT);
+
+private:
+    int count, capacity;
+    glm::vec3 pivot;
+    float gravity;
+    float *x, *z, *vx, *vz, *ax, *az, *mass, *L;
+    float *theta, *omega;
+};
+
+#endif // ENSEMBLE_H
@@ -0,0 +1,89 @@
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+#include <cmath>
+#include "simd.hpp"
+
+// Polynomial sin, cos, sincos and atan for the force evaluation, in a scalar
+// float version and a vfloat version that steps SIMD_WIDTH lanes at once.
+// Both are instantiated from the same template, so lanes and scalars agree
+// up to FMA contraction of the scalar code.
+//
+// sin/cos reduce x by multiples of pi/2 (three-part Cody-Waite constant) to
+// [-pi/4, pi/4] and evaluate the Cephes sinf/cosf polynomials there. atan
+// folds |x| into [0, tan(pi/8)] with atan(x) = pi/2 - atan(1/x) and
+// atan(x) = pi/4 + atan((x-1)/(x+1)), then evaluates the Cephes atanf
+// polynomial.
+//
+// Maximum absolute error against double precision libm, measured by
+// bench/fastmath_bench:
+//   sin, cos   |x| <= 8192    1e-7     (reduction loses accuracy beyond)
+//   atan       all x          1.5e-7   (about one ulp near pi/2)
+// No branches or table lookups; NaN and infinity handling is not guaranteed.
+
+namespace fastmath_detail
+{
+    template<typename F> inline F constant(float c);
+    template<> inline float constant<float>(float c) { return c; }
+    inline float floorOf(float a) { return std::floor(a); }
+    inline float absOf(float a) { return std::fabs(a); }
+    inline float select(bool m, float a, float b) { return m ? a : b; }
+
+    template<> inline vfloat constant<vfloat>(float c) { return vset(c); }
+    inline vfloat floorOf(vfloat a) { return vfloor(a); }
+    inline vfloat absOf(vfloat a) { return vabs(a); }
+    inline vfloat select(vmask m, vfloat a, vfloat b) { return vselect(m, a, b); }
+
+    template<typename F>
+    inline void sincos(F x, F &s, F &c)
+    {
+        const F one = constant<F>(1.0f);
+        F k = floorOf(x * constant<F>(0.63661977236758134f) + constant<F>(0.5f));
+        F r = x - k * constant<F>(1.5703125f);
+        r = r - k * constant<F>(4.837512969970703125e-4f);
+        r = r - k * constant<F>(7.54978995489188216e-8f);
+        // quadrant 0..3 of x
+        F q = k - constant<F>(4.0f) * floorOf(k * constant<F>(0.25f));
+
+        F z = r * r;
+        F ps = ((constant<F>(-1.9515295891e-4f) * z + constant<F>(8.3321608736e-3f)) * z
+                - constant<F>(1.6666654611e-1f)) * z * r + r;
+        F pc = ((constant<F>(2.443315711809948e-5f) * z - constant<F>(1.388731625493765e-3f)) * z
+                + constant<F>(4.166664568298827e-2f)) * z * z - constant<F>(0.5f) * z + one;
+
+        // quadrants 1 and 3 swap sin and cos; 2, 3 negate sin; 1, 2 negate cos
+        auto odd = ((q > constant<F>(0.5f)) & (q < constant<F>(1.5f))) | (q > constant<F>(2.5f));
+        F sr = select(odd, pc, ps);
+        F cr = select(odd, ps, pc);
+        s = select(q > constant<F>(1.5f), -sr, sr);
+        c = select((q > constant<F>(0.5f)) & (q < constant<F>(2.5f)), -cr, cr);
+    }
+
+    template<typename F>
+    inline F atan(F x)
+    {
+        const F one = constant<F>(1.0f);
+        F ax = absOf(x);
+        auto big = ax > constant<F>(2.414213562373095f);
+        auto mid = ax > constant<F>(0.4142135623730950f);
+        F xr = select(big, -(one / ax), select(mid, (ax - one) / (ax + one), ax));
+        F y0 = select(big, constant<F>(1.5707963267948966f), select(mid, constant<F>(0.7853981633974483f), constant<F>(0.0f)));
+        F z = xr * xr;
+        F y = (((constant<F>(8.05374449538e-2f) * z - constant<F>(1.38776856032e-1f)) * z
+                + constant<F>(1.99777106478e-1f)) * z - constant<F>(3.33329491539e-1f)) * z * xr + xr;
+        F r = y0 + y;
+        return select(x < constant<F>(0.0f), -r, r);
+    }
+}
+
+inline void fastSincos(float x, float &s, float &c) { fastmath_detail::sincos(x, s, c); }
+inline float fastSin(float x) { float s, c; fastmath_detail::sincos(x, s, c); return s; }
+inline float fastCos(float x) { float s, c; fastmath_detail::sincos(x, s, c); return c; }
+inline float fastAtan(float x) { return fastmath_detail::atan(x); }
+
+inline void vsincos(vfloat x, vfloat &s, vfloat &c) { fastmath_detail::sincos(x, s, c); }
+inline vfloat vsin(vfloat x) { vfloat s, c; fastmath_detail::sincos(x, s, c); return s; }
+inline vfloat vcos(vfloat x) { vfloat s, c; fastmath_detail::sincos(x, s, c); return c; }
+inline vfloat vatan(vfloat x) { return fastmath_detail::atan(x); }
+
+#endif // FASTMATH_H
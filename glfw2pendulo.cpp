@@ -4,24 +4,37 @@
 #include <fstream>
 #include <chrono>
 #include <string>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "sphere.hpp"
 #include "plane.hpp"
 #include "line.hpp"
+#include "physics.hpp"
+#include "integrators.hpp"
+#include "logger.hpp"
+#include "trajectory.hpp"
+#include "scheduler.hpp"
+#include "ensemble.hpp"
+#include "instanced.hpp"
+#include "profiler.hpp"
+#include "chain.hpp"
+#include "checkpoint.hpp"
+#include "triplebuffer.hpp"
+#include "transforms.hpp"
+#include "recorder.hpp"
+#include "monitor.hpp"
 
 #define GL_LOG_FILE "gl.log"
-#define PH_LOG_FILE "ph.log"
-
-const float gravity = 9.80665f;
-const float R = 0.5f;
-const glm::vec3 puntofijo = glm::vec3(0.0f,0.0f,4.0f);
-const float L = 2.0f;
-const float theta0 = glm::pi<float>()/4;
 
 std::ofstream log_file;
-std::ofstream ph_log_file;
 
 std::ostream& operator<<(std::ostream& stream, const std::chrono::system_clock::time_point& point)
 {
@@ -38,6 +51,40 @@ std::ostream& operator<<(std::ostream& stream, const std::chrono::system_clock::
     return stream << micro.count();
 }
 
+// one frame's worth of gl.log, formatted on the logger thread
+struct FrameRecord
+{
+	std::chrono::system_clock::time_point t_now;
+	std::chrono::system_clock::time_point t_after_frame_display;
+	float frame_time;
+	float fps;
+	float time;
+};
+
+void format_frame_record(std::string &out, const FrameRecord &rec) {
+	std::ostringstream stream;
+	stream << "t_now: " << rec.t_now << std::endl;
+	stream << "t_after_frame_display: " << rec.t_after_frame_display << std::endl;
+	stream << "frame_time: " << rec.frame_time << std::endl;
+	stream << "fps: " << rec.fps << std::endl;
+	stream << "time: " << rec.time <<  std::endl;
+	out += stream.str();
+}
+
+AsyncLogger<FrameRecord> frame_log;
+
+// What the simulation thread hands to the render thread after each batch of
+// steps: positions after the last two steps, so the frame can be drawn as a
+// blend of them, and when the last one finished.
+struct SimFrame
+{
+	long long step;
+	std::chrono::steady_clock::time_point time;
+	glm::vec3 pendulum[2];
+	std::vector<glm::vec3> ensemble[2];
+	std::vector<glm::vec3> chain[2];
+};
+
 /* start a new log file. put the time and date at the top */
 bool restart_gl_log() {
 	log_file.open(GL_LOG_FILE);
@@ -60,225 +107,10 @@ float g_gl_height = 800.0;
 void glfw_framebuffer_size_callback( GLFWwindow *window, int width, int height ) {
 	g_gl_width = float(width);
 	g_gl_height = float(height);
-	/* update any perspective matrices used here */
-}
-
-void updateAcceleration (Sphere &sphere){
-	glm::vec3 totalForce;
-	glm::vec3 r = glm::vec3(sphere.getPosition().x-puntofijo.x,sphere.getPosition().y-puntofijo.y,sphere.getPosition().z-puntofijo.z);
-	float theta = glm::atan((sphere.getPosition().x-puntofijo.x)/(puntofijo.z-sphere.getPosition().z));
-	//glm::vec3 thetavel = glm::cross(r,sphere.getVelocity());
-	glm::vec3 thetavel = glm::vec3(0.0f,glm::length(sphere.getVelocity())/L,0.0f);
-	float T = sphere.getMass()*gravity*glm::cos(theta)+sphere.getMass()*L*thetavel.y*thetavel.y;
-	float Ft = -sphere.getMass()*gravity*glm::sin(theta);
-	float Fn = -T + sphere.getMass()*gravity*glm::cos(theta);
-
-	totalForce.x = Fn*glm::sin(theta)+Ft*glm::cos(theta);
-	totalForce.y = 0.0f;
-	totalForce.z = -Fn*glm::cos(theta)+Ft*glm::sin(theta);
-	sphere.setAcceleration(totalForce/(sphere.getMass()));
-
-	ph_log_file.open(PH_LOG_FILE,std::ios::app);
-	ph_log_file <<"Position: " << sphere.getPosition().x << "  " << sphere.getPosition().y << "  " << sphere.getPosition().z << "  "
-				<< "r: " << r.x << "  " << r.y << "  " << r.z << "   " << "L: " << glm::length(r) << "   "
-				<< "T: " << T << "   "
-	            << "Velocity: " << sphere.getVelocity().x << "  " << sphere.getVelocity().y << "  " << sphere.getVelocity().z << "   "
-				<< "Acceleration: " << sphere.getAcceleration().x << "  " << sphere.getAcceleration().y << "  " << sphere.getAcceleration().z << "  "
-				<< "Theta:  " << theta*180.0f/glm::pi<float>() << "  Thetavel:  " << thetavel.x << "  "<< thetavel.y << "  "<< thetavel.z << std::endl;
-	
-	ph_log_file.close();
-}
-
-void IntegrateEuler(Sphere &sphere, float DT){
-		sphere.setVelocity(sphere.getAcceleration()*DT + sphere.getVelocity());
-		sphere.setPosition(sphere.getVelocity()*DT + sphere.getPosition());
-		updateAcceleration(sphere);
-}
-
-void IntegrateRK4(Sphere &bola, float DT)
-{
-	glm::vec3 Pos;
-	glm::vec3 Vel;
-
-	glm::vec3 Kv1,Kv2,Kv3,Kv4; //Son aceleraciones
-	glm::vec3 Kx1,Kx2,Kx3,Kx4; //Son velocidades
-	glm::vec3 xK2,xK3,xK4; //Son las posiciones estimadas para evaluar la aceleracion
-
-	Kv1 = bola.getAcceleration();
-	Kx1 = bola.getVelocity();
-
-	xK2 = bola.getPosition() + Kx1*DT/2.0f;
-	updateAcceleration(bola);
-	Kv2 = bola.getAcceleration();
-	Kx2 = bola.getVelocity() + Kv1 * DT/2.0f;
-
-	xK3 = bola.getPosition() + Kx2*DT/2.0f;
-	updateAcceleration(bola);
-	Kv3 = bola.getAcceleration();
-	Kx3 = bola.getVelocity() + Kv2 * DT/2.0f;
-
-	xK4 = bola.getPosition() + Kx3*DT;
-	updateAcceleration(bola);
-	Kv4 = bola.getAcceleration();
-	Kx4 = bola.getVelocity() + Kv3 * DT;
-
-    Vel = bola.getVelocity() + (Kv1+Kv2*2.0f+Kv3*2.0f+Kv4)/6.0f*DT;
-    Pos = bola.getPosition() + (Kx1+Kx2*2.0f+Kx3*2.0f+Kx4)/6.0f*DT;
-
-	bola.setVelocity(Vel); // Update object's velocity
-	bola.setPosition(Pos); // Update object's position
-}
-
-void IntegrateVerlet (Sphere &sphere, float DT){
-        sphere.setPosition(sphere.getPosition() + sphere.getVelocity()*DT + 1.0f/2.0f*sphere.getAcceleration()*DT*DT);
-        glm::vec3 oldAcceleration=sphere.getAcceleration();
-        updateAcceleration(sphere);
-        sphere.setVelocity(sphere.getVelocity() + 1.0f/2.0f*(oldAcceleration*DT+sphere.getAcceleration()*DT));
-}
-
-void CheckBC(Sphere &sphere) {
-	if (sphere.getPosition().z <= R){
-			glm::vec3 oldVelocity;
-			glm::vec3 newVelocity;
-			oldVelocity = sphere.getVelocity();
-			newVelocity = oldVelocity;
-			newVelocity.z = -oldVelocity.z;
-			sphere.setVelocity(newVelocity);
-
-			glm::vec3 oldPosition;
-			glm::vec3 newPosition;
-			oldPosition = sphere.getPosition();
-			newPosition = oldPosition;
-			newPosition.z = R;
-			sphere.setPosition(newPosition);
-			
-		}
-
-		if (sphere.getPosition().x <= -2+R){
-			glm::vec3 oldVelocity;
-			glm::vec3 newVelocity;
-			oldVelocity = sphere.getVelocity();
-			newVelocity = oldVelocity;
-			newVelocity.x = -oldVelocity.x;
-			sphere.setVelocity(newVelocity);
-
-			glm::vec3 oldPosition;
-			glm::vec3 newPosition;
-			oldPosition = sphere.getPosition();
-			newPosition = oldPosition;
-			newPosition.x = -2+R;
-			sphere.setPosition(newPosition);
-			
-		}
-
-		if (sphere.getPosition().x >= 2-R){
-			glm::vec3 oldVelocity;
-			glm::vec3 newVelocity;
-			oldVelocity = sphere.getVelocity();
-			newVelocity = oldVelocity;
-			newVelocity.x = -oldVelocity.x;
-			sphere.setVelocity(newVelocity);
-
-			glm::vec3 oldPosition;
-			glm::vec3 newPosition;
-			oldPosition = sphere.getPosition();
-			newPosition = oldPosition;
-			newPosition.x = 2-R;
-			sphere.setPosition(newPosition);
-			
-		}
-
-		if (sphere.getPosition().y <= -2+R){
-			glm::vec3 oldVelocity;
-			glm::vec3 newVelocity;
-			oldVelocity = sphere.getVelocity();
-			newVelocity = oldVelocity;
-			newVelocity.y = -oldVelocity.y;
-			sphere.setVelocity(newVelocity);
-
-			glm::vec3 oldPosition;
-			glm::vec3 newPosition;
-			oldPosition = sphere.getPosition();
-			newPosition = oldPosition;
-			newPosition.y = -2+R;
-			sphere.setPosition(newPosition);
-			
-		}
-
-		if (sphere.getPosition().y >= 2-R){
-			glm::vec3 oldVelocity;
-			glm::vec3 newVelocity;
-			oldVelocity = sphere.getVelocity();
-			newVelocity = oldVelocity;
-			newVelocity.y = -oldVelocity.y;
-			sphere.setVelocity(newVelocity);
-
-			glm::vec3 oldPosition;
-			glm::vec3 newPosition;
-			oldPosition = sphere.getPosition();
-			newPosition = oldPosition;
-			newPosition.y = 2-R;
-			sphere.setPosition(newPosition);
-			
-		}
-		
-}
-
-void SphereCollision (Sphere &sph1, Sphere &sph2){
-	if (glm::distance(sph1.getPosition(),sph2.getPosition()) <= 2*R){
-			glm::vec3 oldPosition1;
-			glm::vec3 oldPosition2;
-			glm::vec3 oldVelocity1;
-			glm::vec3 oldVelocity2;
-			glm::vec3 newPosition1;
-			glm::vec3 newPosition2;
-			glm::vec3 newVelocity1;
-			glm::vec3 newVelocity2;
-
-			oldPosition1 = sph1.getPosition();
-			oldPosition2 = sph2.getPosition();
-			oldVelocity1 = sph1.getVelocity();
-			oldVelocity2 = sph2.getVelocity();
-
-			/*newVelocity1 = oldVelocity1 + 
-			     glm::length(oldPosition2 - oldPosition1)*
-				 glm::dot(oldVelocity2,(oldPosition2 - oldPosition1))/
-				 glm::dot((oldPosition2 - oldPosition1),(oldPosition2 - oldPosition1)) -
-				 glm::length(oldPosition1 - oldPosition2)*
-				 glm::dot(oldVelocity1,(oldPosition1 - oldPosition2))/
-				 glm::dot((oldPosition1 - oldPosition2),(oldPosition1 - oldPosition2));
-
-			newVelocity2 = oldVelocity2 + 
-			     glm::length(oldPosition2 - oldPosition1)*
-				 glm::dot(oldVelocity1,(oldPosition2 - oldPosition1))/
-				 glm::dot((oldPosition2 - oldPosition1),(oldPosition2 - oldPosition1)) -
-				 glm::length(oldPosition1 - oldPosition2)*
-				 glm::dot(oldVelocity2,(oldPosition1 - oldPosition2))/
-				 glm::dot((oldPosition1 - oldPosition2),(oldPosition1 - oldPosition2));*/
-
-			glm::vec3 vecx = oldPosition1 - oldPosition2;
-			glm::normalize(vecx);
-			float x1 = glm::dot(vecx,oldVelocity1);
-			glm::vec3 vecv1x = vecx * x1;
-			glm::vec3 vecv1y = oldVelocity1 - vecv1x;
-			float m1 = sph1.getMass();
-
-			vecx = -vecx;
-			float x2 = glm::dot(vecx,oldVelocity2);
-			glm::vec3 vecv2x = vecx * x2;
-			glm::vec3 vecv2y = oldVelocity2 - vecv2x;
-			float m2 = sph2.getMass();
-
-			newVelocity1 = vecv1x*(m1-m2)/(m1+m2)+vecv2x*(2*m2)/(m1+m2) + vecv1y;
-			newVelocity2 = vecv1x*(2*m1)/(m1+m2)+vecv2x*(m2-m1)/(m1+m2) + vecv2y;
-
-
-			sph1.setVelocity(newVelocity1);
-			sph2.setVelocity(newVelocity2);
-		}
+	/* the projection follows with the next frame's camera upload */
 }
 
-int main() {
+int main(int argc, char **argv) {
 	GLFWwindow *window;
 	const GLubyte *renderer;
 	const GLubyte *version;
@@ -287,29 +119,244 @@ int main() {
 	float fps = 0.0f;
 	float frame_time = 0.0f;
 	float frame_time_cummulated = 0.0f;
+	unsigned ph_log_sampling = 1;	// 0 turns the log off
+	unsigned gl_log_sampling = 1;
+	const char *replay_path = NULL;
+	TrajectoryReader replay;
+	float physics_dt = 1.0f/120.0f;
+	int substeps = 1;
+	int max_steps = 8;
+	FixedStepScheduler scheduler;
+	Body pendulum;
+	glm::vec3 previous_position;
+	glm::vec3 render_position;
+	int ensemble_size = 0;
+	Ensemble ensemble;
+	SphereInstancer instancer;
+	std::vector<glm::vec3> ensemble_previous;
+	std::vector<glm::vec3> ensemble_render;
+	std::vector<glm::vec3> rods;
+	bool cartesian = false;
+	PhaseState<float> angle_state;
+	int chain_links = 0;
+	PendulumChain chain;
+	Sphere chain_sphere;
+	std::vector<glm::vec3> chain_previous;
+	std::vector<glm::vec3> chain_points;
+	std::vector<glm::vec3> chain_render;
+	const char *checkpoint_path = NULL;
+	float checkpoint_every = 10.0f;	// seconds of simulated time
+	long long checkpoint_steps = 0;
+	CheckpointWriter checkpoint;
+	const char *resume_path = NULL;
+	double seek_time = -1.0;
+	// --record renders into an offscreen framebuffer at a fixed frame rate
+	// of simulated time and writes the frames out instead of showing them
+	const char *record_path = NULL;
+	const char *record_pipe = NULL;
+	float record_fps = 60.0f;
+	long long record_frames = 600;
+	int record_width = 1024;
+	int record_height = 800;
+	const char *gl_api = "native";
+	FrameRecorder recorder;
+	// follows the pendulum's energy, rod length and Lz on the simulation
+	// thread; its report goes to the profile log
+	ConservationMonitor monitor;
+	MonitorThresholds monitor_limits = { 0.0, 0.0, 0.0, 0.0 };
+	Snapshot resume;
+	// physics runs on its own thread and publishes SimFrames; the render loop
+	// draws the latest one and never waits for it
+	TripleBuffer<SimFrame> frames;
+	std::thread sim_thread;
+	std::atomic<bool> sim_running(false);
+	// CPU time per frame phase; draw phases measure command submission, the
+	// GPU work shows up in swap_buffers
+	FrameProfiler profiler;
+	const char *profile_path = "profile.log";
+	bool summary_key_down = false;
+	int ph_frame = profiler.addPhase("frame");
+	int ph_handoff = profiler.addPhase("sim_handoff");
+	int ph_clear = profiler.addPhase("clear");
+	int ph_plane = profiler.addPhase("draw_plane");
+	int ph_line = profiler.addPhase("draw_line");
+	int ph_transforms = profiler.addPhase("upload_transforms");
+	int ph_sphere = profiler.addPhase("draw_sphere");
+	int ph_ensemble = profiler.addPhase("draw_ensemble");
+	int ph_chain = profiler.addPhase("draw_chain");
+	int ph_poll = profiler.addPhase("poll_events");
+	int ph_swap = profiler.addPhase("swap_buffers");
+	int ph_record = profiler.addPhase("record");
+	// written by the simulation thread only, reported after it has stopped
+	FrameProfiler sim_profiler;
+	int ph_step = sim_profiler.addPhase("physics_step");
+
+	for (int i = 1; i < argc; ++i){
+		if (strcmp(argv[i],"--ph-log") == 0 && i+1 < argc){
+			ph_log_sampling = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--gl-log") == 0 && i+1 < argc){
+			gl_log_sampling = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--replay") == 0 && i+1 < argc){
+			replay_path = argv[++i];
+		} else if (strcmp(argv[i],"--dt") == 0 && i+1 < argc){
+			physics_dt = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i],"--substeps") == 0 && i+1 < argc){
+			substeps = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--max-steps") == 0 && i+1 < argc){
+			max_steps = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--ensemble") == 0 && i+1 < argc){
+			ensemble_size = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--chain") == 0 && i+1 < argc){
+			chain_links = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--cartesian") == 0){
+			cartesian = true;
+		} else if (strcmp(argv[i],"--fast-trig") == 0){
+			setFastTrig(true);
+		} else if (strcmp(argv[i],"--profile") == 0 && i+1 < argc){
+			profile_path = argv[++i];
+		} else if (strcmp(argv[i],"--checkpoint") == 0 && i+1 < argc){
+			checkpoint_path = argv[++i];
+		} else if (strcmp(argv[i],"--checkpoint-every") == 0 && i+1 < argc){
+			checkpoint_every = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i],"--resume") == 0 && i+1 < argc){
+			resume_path = argv[++i];
+		} else if (strcmp(argv[i],"--seek") == 0 && i+1 < argc){
+			seek_time = atof(argv[++i]);
+		} else if (strcmp(argv[i],"--record") == 0 && i+1 < argc){
+			record_path = argv[++i];
+		} else if (strcmp(argv[i],"--record-pipe") == 0 && i+1 < argc){
+			record_pipe = argv[++i];
+		} else if (strcmp(argv[i],"--record-fps") == 0 && i+1 < argc){
+			record_fps = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i],"--record-frames") == 0 && i+1 < argc){
+			record_frames = atoll(argv[++i]);
+		} else if (strcmp(argv[i],"--record-size") == 0 && i+2 < argc){
+			record_width = atoi(argv[++i]);
+			record_height = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--gl-api") == 0 && i+1 < argc){
+			gl_api = argv[++i];
+		} else if (strcmp(argv[i],"--max-drift") == 0 && i+1 < argc){
+			monitor_limits.energyDrift = atof(argv[++i]);
+		} else if (strcmp(argv[i],"--max-energy-error") == 0 && i+1 < argc){
+			monitor_limits.energyError = atof(argv[++i]);
+		} else if (strcmp(argv[i],"--max-constraint") == 0 && i+1 < argc){
+			monitor_limits.constraintError = atof(argv[++i]);
+		} else {
+			std::cerr << "usage: " << argv[0] << " [--ph-log every_n] [--gl-log every_n] [--replay file.traj]"
+			          << " [--dt seconds] [--substeps n] [--max-steps n] [--ensemble n] [--chain n] [--cartesian] [--fast-trig] [--profile file]"
+			          << " [--checkpoint file] [--checkpoint-every seconds] [--resume file] [--seek t]"
+			          << " [--record file|pattern%d.png] [--record-pipe command] [--record-fps f] [--record-frames n]"
+			          << " [--record-size width height] [--gl-api native|egl|osmesa]"
+			          << " [--max-drift d] [--max-energy-error e] [--max-constraint c]" << std::endl;
+			return 1;
+		}
+	}
 	
 	Sphere sphere1;
 	Plane plane1;
 	Line line1;
 
+	// a resumed run takes its configuration from the checkpoint; the state is
+	// applied once everything is initialised
+	if (resume_path){
+		CheckpointReader reader;
+		if (replay_path || !reader.open(resume_path) || reader.size() == 0){
+			std::cerr << "cannot resume from " << resume_path << std::endl;
+			return 1;
+		}
+		const CheckpointHeader &h = reader.getHeader();
+		size_t index = seek_time >= 0.0 ? reader.findTime(seek_time) : reader.size() - 1;
+		if (h.integrator != INTEGRATOR_RK4 || (h.flags & CKPT_CHECK_BC) || !reader.read(index,resume) ||
+		    resume.bodies.size() != 1 || resume.values.size() != 3 + 10*(size_t)h.ensembleSize + 5*(size_t)h.chainLinks){
+			std::cerr << resume_path << " is not a checkpoint of this viewer" << std::endl;
+			return 1;
+		}
+		physics_dt = h.dt;
+		substeps = h.substeps;
+		cartesian = (h.flags & CKPT_CARTESIAN) != 0;
+		ensemble_size = h.ensembleSize;
+		chain_links = h.chainLinks;
+	} else if (seek_time >= 0.0){
+		std::cerr << "--seek needs --resume" << std::endl;
+		return 1;
+	}
+
+	if (physics_dt <= 0.0f){
+		std::cerr << "--dt must be positive" << std::endl;
+		return 1;
+	}
+	const bool recording = record_path || record_pipe;
+	if (recording){
+		if ((record_path && record_pipe) || record_fps <= 0.0f || record_frames <= 0 ||
+		    record_width <= 0 || record_height <= 0){
+			std::cerr << "--record or --record-pipe needs a positive frame rate, frame count and size" << std::endl;
+			return 1;
+		}
+		// every frame advances by exactly 1/fps, so no step may be dropped
+		max_steps = std::max(max_steps,(int)(1.0f/(record_fps*physics_dt)) + 2);
+		g_gl_width = float(record_width);
+		g_gl_height = float(record_height);
+	}
+	if (strcmp(gl_api,"native") != 0 && strcmp(gl_api,"egl") != 0 && strcmp(gl_api,"osmesa") != 0){
+		std::cerr << "--gl-api must be native, egl or osmesa" << std::endl;
+		return 1;
+	}
+	scheduler.init(physics_dt,substeps,max_steps);
+
+	if (checkpoint_path){
+		if (checkpoint_every <= 0.0f){
+			std::cerr << "--checkpoint-every must be positive" << std::endl;
+			return 1;
+		}
+		CheckpointHeader h = makeCheckpointHeader(physics_dt,INTEGRATOR_RK4,scheduler.getSubsteps());
+		h.flags = cartesian ? CKPT_CARTESIAN : 0;
+		h.bodyCount = 1;
+		h.ensembleSize = ensemble_size;
+		h.chainLinks = chain_links;
+		if (!checkpoint.open(checkpoint_path,h)){
+			std::cerr << "cannot write " << checkpoint_path << std::endl;
+			return 1;
+		}
+		checkpoint_steps = std::max(1LL,(long long)std::llround(checkpoint_every/physics_dt));
+	}
+
+	// a recorded run drives the sphere instead of the integrator
+	if (replay_path && (!replay.open(replay_path) || replay.size() == 0)){
+		std::cerr << "cannot replay " << replay_path << std::endl;
+		return 1;
+	}
+
 	restart_gl_log();
 	auto t_start = std::chrono::high_resolution_clock::now();
 	
 	log_file.open(GL_LOG_FILE,std::ios::app);
 	log_file << "t_start: " << t_start << std::endl;
 	log_file.close();
+	if (gl_log_sampling > 0 && frame_log.init(GL_LOG_FILE,format_frame_record)){
+		frame_log.setSampling(gl_log_sampling);
+	}
+	if (ph_log_sampling > 0){
+		startPhysicsLog(ph_log_sampling);
+	}
 	
 	GLuint vbo;
 	GLuint vao;
-	const char *vertex_shader = "#version 410\n"
+	// view and proj come from the Camera block, the model matrix from the
+	// per-frame object buffer (transforms.hpp)
+	const char *vertex_shader[] = { "#version 410\n", cameraShaderSource, objectShaderSource,
 		"in vec3 vp;"
-		"uniform mat4 model;"
-		"uniform mat4 view;"
-		"uniform mat4 proj;"
 		"void main() {"
 		"  gl_PointSize = 10.0;"
-		"  gl_Position = proj * view * model * vec4( vp, 1.0 );"
-		"}";
+		"  gl_Position = proj * view * objectModel() * vec4( vp, 1.0 );"
+		"}" };
+
+	// same camera, but each instance is moved by its own offset
+	const char *vertex_shader_instanced[] = { "#version 410\n", cameraShaderSource,
+		"in vec3 vp;"
+		"in vec3 offset;"
+		"void main() {"
+		"  gl_Position = proj * view * vec4( vp + offset, 1.0 );"
+		"}" };
 
 	const char *fragment_shader = "#version 410\n"
 		"out vec4 frag_colour;"
@@ -317,14 +364,37 @@ int main() {
 		"  frag_colour = vec4( 0.5, 0.5, 0.5, 1.0 );"
 		"}";
 	GLuint shader_programme, vs, fs;
+	GLuint instanced_programme, vs_instanced;
 
 	// start GL context and O/S window using the GLFW helper library
 	glfwSetErrorCallback( glfw_error_callback );
+#ifdef GLFW_PLATFORM_NULL
+	// OSMesa needs no display server at all
+	if (strcmp(gl_api,"osmesa") == 0){
+		glfwInitHint( GLFW_PLATFORM, GLFW_PLATFORM_NULL );
+	}
+#endif
 	if ( !glfwInit() ) {
 		return 1;
 	}
 	// set anti-aliasing factor to make diagonal edges appear less jagged
 	glfwWindowHint( GLFW_SAMPLES, 4 );
+	if (strcmp(gl_api,"egl") == 0){
+		glfwWindowHint( GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API );
+	}
+#ifdef GLFW_OSMESA_CONTEXT_API
+	if (strcmp(gl_api,"osmesa") == 0){
+		glfwWindowHint( GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API );
+	}
+#endif
+	// a recording draws offscreen, so the window only carries the context
+	if (recording){
+		glfwWindowHint( GLFW_VISIBLE, 0 );
+		glfwWindowHint( GLFW_CONTEXT_VERSION_MAJOR, 4 );
+		glfwWindowHint( GLFW_CONTEXT_VERSION_MINOR, 1 );
+		glfwWindowHint( GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE );
+		glfwWindowHint( GLFW_OPENGL_FORWARD_COMPAT, 1 );
+	}
 
 	/* we can run a full-screen window here */
 
@@ -345,7 +415,22 @@ int main() {
 
 	// start GLEW extension handler
 	glewExperimental = GL_TRUE;
-	glewInit();
+	GLenum glew_status = glewInit();
+	if (recording){
+		// a headless context needs a GLEW built for EGL or OSMesa
+		if (glew_status != GLEW_OK){
+			std::cerr << "cannot load GL functions: " << glewGetErrorString(glew_status) << std::endl;
+			glfwTerminate();
+			return 1;
+		}
+		if (!recorder.init(record_width,record_height) ||
+		    !(record_path ? recorder.openFile(record_path) : recorder.openPipe(record_pipe))){
+			std::cerr << "cannot record to " << (record_path ? record_path : record_pipe) << std::endl;
+			recorder.cleanup();
+			glfwTerminate();
+			return 1;
+		}
+	}
 
 	// get version info
 	renderer = glGetString( GL_RENDERER ); // get renderer string
@@ -357,7 +442,7 @@ int main() {
 	glDepthFunc( GL_LESS );		 // depth-testing interprets a smaller value as "closer"
 	
 	vs = glCreateShader( GL_VERTEX_SHADER );
-	glShaderSource( vs, 1, &vertex_shader, NULL );
+	glShaderSource( vs, 4, vertex_shader, NULL );
 	glCompileShader( vs );
 	fs = glCreateShader( GL_FRAGMENT_SHADER );
 	glShaderSource( fs, 1, &fragment_shader, NULL );
@@ -370,85 +455,392 @@ int main() {
 	
 	GLuint vp = glGetAttribLocation(shader_programme, "vp");
 	sphere1.init(vp,R);
-	sphere1.setMass(1.0f);
-	sphere1.setPosition(glm::vec3(puntofijo.x + L*glm::sin(theta0),0.0f,puntofijo.z - L*glm::cos(theta0)));
-	sphere1.setVelocity(glm::vec3(0.0f,0.0f,0.0f));
-	updateAcceleration(sphere1);
+	initPendulum(pendulum);
+	angle_state = initAngle();
+	previous_position = pendulum.getPosition();
+	render_position = pendulum.getPosition();
 
 	plane1.init(vp,0.0f);
 
-	line1.init(vp,puntofijo,sphere1.getPosition());
-	
-	GLint uniModel = glGetUniformLocation(shader_programme, "model");
+	// the main rod, every ensemble rod and every chain link are streamed into one buffer per frame
+	line1.init(vp,1 + ensemble_size + chain_links);
+
+	// an N-link chain of the same total length in front of the main pendulum,
+	// its bobs drawn as instances of one Sphere
+	if (chain_links > 0){
+		chain.init(chain_links,puntofijo + glm::vec3(0.0f,-3.0f,0.0f));
+		for (int i = 0; i < chain_links; ++i){
+			chain.setLink(i,theta0,0.0f,L/chain_links,1.0f);
+		}
+		chain.updateAcceleration();
+		chain.getPositions(chain_points);
+		chain_previous = chain_points;
+		chain_render = chain_points;
+		chain_sphere.init(vp,std::min(R,0.5f*L/chain_links));
+	}
+
+	// one camera block for both programs, and one buffer with every model
+	// matrix of the frame: the plane and rods, the pendulum, the chain bobs
+	CameraBlock camera;
+	camera.init();
+	camera.attach(shader_programme);
+	ObjectTransforms objects;
+	objects.init(2 + chain_links);
+	GLint uniObjectBase = objects.attach(shader_programme);
 
     // Set up projection
+    glm::vec3 eye = glm::vec3(0.0f, -10.0f, 10.0f);
     glm::mat4 view = glm::lookAt(
-        glm::vec3(0.0f, -10.0f, 10.0f),
+        eye,
         glm::vec3(0.0f, 0.0f, 0.0f),
         glm::vec3(0.0f, 0.0f, 1.0f)
     );
 
-    GLint uniView = glGetUniformLocation(shader_programme, "view");
-    glUniformMatrix4fv(uniView, 1, GL_FALSE, glm::value_ptr(view));
 
-    glm::mat4 proj = glm::perspective(
-		glm::radians(45.0f), 
-		g_gl_width / g_gl_height, 
-		1.0f, 
-		20.0f
-	);
-
-    GLint uniProj = glGetUniformLocation(shader_programme, "proj");
-    glUniformMatrix4fv(uniProj, 1, GL_FALSE, glm::value_ptr(proj));
+	// a row of pendulums along y with growing rod lengths, all drawn with one
+	// instanced call
+	if (ensemble_size > 0){
+		vs_instanced = glCreateShader( GL_VERTEX_SHADER );
+		glShaderSource( vs_instanced, 3, vertex_shader_instanced, NULL );
+		glCompileShader( vs_instanced );
+		instanced_programme = glCreateProgram();
+		glAttachShader( instanced_programme, fs );
+		glAttachShader( instanced_programme, vs_instanced );
+		glLinkProgram( instanced_programme );
+		camera.attach(instanced_programme);
+
+		float radius = std::min(R, 2.0f/ensemble_size);
+		instancer.init(glGetAttribLocation(instanced_programme, "vp"), glGetAttribLocation(instanced_programme, "offset"),
+		               radius, ensemble_size);
+		ensemble.init(ensemble_size, puntofijo, gravity);
+		for (int i = 0; i < ensemble_size; ++i){
+			float f = ensemble_size > 1 ? (float)i/(ensemble_size - 1) : 0.0f;
+			ensemble.setPendulum(i, theta0, 0.0f, 1.0f + 2.0f*f, 1.0f);
+			ensemble_previous.push_back(ensemble.getPosition(i));
+		}
+		ensemble_render = ensemble_previous;
+		glUseProgram( shader_programme );
+	}
 
+	// one fixed step of everything that is simulated
+	auto physics_step = [&]() {
+		for (int k = 0; k < scheduler.getSubsteps(); ++k){
+			// the pendulum is integrated in (theta, omega) unless --cartesian
+			if (cartesian){
+				IntegrateRK4(pendulum,scheduler.getSubstepDt());
+			} else {
+				IntegrateAngle<RK4>(angle_state,scheduler.getSubstepDt());
+				setPendulumAngle(pendulum,angle_state.x,angle_state.v);
+			}
+			//CheckBC(pendulum);
+			if (ensemble_size > 0 && cartesian){
+				ensemble.IntegrateRK4(scheduler.getSubstepDt());
+			} else if (ensemble_size > 0){
+				ensemble.IntegrateAngleRK4(scheduler.getSubstepDt());
+			}
+			if (chain_links > 0){
+				chain.step<RK4>(scheduler.getSubstepDt());
+			}
+		}
+	};
+
+	// snapshot layout: the pendulum's Body, its angle state, then the
+	// ensemble and the chain arrays
+	auto save_snapshot = [&](long long step) {
+		Snapshot snap;
+		snap.time = (double)physics_dt*step;
+		snap.step = step;
+		snap.bodies.push_back(pendulum);
+		snap.values.push_back(angle_state.x);
+		snap.values.push_back(angle_state.v);
+		snap.values.push_back(angle_state.a);
+		if (ensemble_size > 0){
+			ensemble.saveState(snap.values);
+		}
+		if (chain_links > 0){
+			chain.saveState(snap.values);
+		}
+		if (!checkpoint.write(snap)){
+			std::cerr << "cannot write " << checkpoint_path << std::endl;
+			checkpoint.close();
+		}
+	};
+
+	if (resume_path){
+		pendulum = resume.bodies[0];
+		angle_state.x = resume.values[0];
+		angle_state.v = resume.values[1];
+		angle_state.a = resume.values[2];
+		const float *values = &resume.values[3];
+		if (ensemble_size > 0){
+			values = ensemble.loadState(values);
+		}
+		if (chain_links > 0){
+			chain.loadState(values);
+		}
+		// integrate from the snapshot up to the requested time
+		long long step = resume.step;
+		if (seek_time >= 0.0){
+			for (long long target = std::llround(seek_time/physics_dt); step < target; ++step){
+				physics_step();
+			}
+		}
+		scheduler.restore(step);
+		previous_position = render_position = pendulum.getPosition();
+		for (int i = 0; i < ensemble_size; ++i){
+			ensemble_previous[i] = ensemble_render[i] = ensemble.getPosition(i);
+		}
+		if (chain_links > 0){
+			chain.getPositions(chain_points);
+			chain_previous = chain_render = chain_points;
+		}
+		std::cout << "resumed from " << resume_path << " at t = " << resume.time << " s, now at "
+		          << scheduler.getSimTime() << " s" << std::endl;
+	}
+	if (checkpoint.isOpen()){
+		save_snapshot(scheduler.getSteps());
+	}
+	monitor.init(pendulum,scheduler.getSimTime());
+	monitor.setThresholds(monitor_limits);
+
+	// copies the positions after the last two steps into the back slot and hands it over
+	auto publish_frame = [&]() {
+		SimFrame &f = frames.writeBuffer();
+		f.step = scheduler.getSteps();
+		f.pendulum[0] = previous_position;
+		f.pendulum[1] = pendulum.getPosition();
+		f.ensemble[0] = ensemble_previous;
+		for (int i = 0; i < ensemble_size; ++i){
+			f.ensemble[1][i] = ensemble.getPosition(i);
+		}
+		f.chain[0] = chain_previous;
+		if (chain_links > 0){
+			chain.getPositions(f.chain[1]);
+		}
+		f.time = std::chrono::steady_clock::now();
+		frames.publish();
+	};
+
+	// runs the steps the scheduler asked for and publishes the result
+	auto run_steps = [&](int steps) {
+		for (int n = 0; n < steps; ++n){
+			if (n == steps - 1){
+				previous_position = pendulum.getPosition();
+				for (int i = 0; i < ensemble_size; ++i){
+					ensemble_previous[i] = ensemble.getPosition(i);
+				}
+				if (chain_links > 0){
+					chain.getPositions(chain_previous);
+				}
+			}
+			{
+				ProfileScope scope(sim_profiler,ph_step);
+				physics_step();
+			}
+			long long step = scheduler.getSteps() - steps + n + 1;
+			unsigned raised = monitor.update(pendulum,(double)physics_dt*step);
+			for (unsigned bit = 1; raised; bit <<= 1){
+				if (raised & bit){
+					std::cerr << "t = " << physics_dt*step << " s: " << monitorAlarmName(bit) << " alarm" << std::endl;
+					raised &= ~bit;
+				}
+			}
+			if (checkpoint.isOpen() && step % checkpoint_steps == 0){
+				save_snapshot(step);
+			}
+		}
+		if (steps > 0){
+			publish_frame();
+		}
+	};
+
+	// Fixed steps at the pace of the wall clock, independent of the frame
+	// rate: whatever time has passed is turned into steps, then the thread
+	// sleeps until the next step is due.
+	auto sim_loop = [&]() {
+		auto last = std::chrono::steady_clock::now();
+		while (sim_running.load(std::memory_order_acquire)){
+			auto now = std::chrono::steady_clock::now();
+			run_steps(scheduler.advance(std::chrono::duration_cast<std::chrono::duration<float>>(now - last).count()));
+			last = now;
+			std::this_thread::sleep_for(std::chrono::duration<double>((1.0 - scheduler.getAlpha())*physics_dt));
+		}
+	};
+
+	if (!replay_path){
+		// slots are sized once; the reader starts on the initial state
+		for (int k = 0; k < 3; ++k){
+			frames.slot(k).ensemble[0].reserve(ensemble_size);
+			frames.slot(k).ensemble[1].resize(ensemble_size);
+			frames.slot(k).chain[0].reserve(chain_links + 1);
+			frames.slot(k).chain[1].reserve(chain_links + 1);
+		}
+		previous_position = pendulum.getPosition();
+		if (chain_links > 0){
+			chain.getPositions(chain_previous);
+		}
+		publish_frame();
+		frames.update();
+		// a recording steps the physics itself, one frame's worth at a time
+		if (!recording){
+			sim_running.store(true, std::memory_order_release);
+			sim_thread = std::thread(sim_loop);
+		}
+	}
+	long long frames_recorded = 0;
+	auto t_record_start = std::chrono::steady_clock::now();
 	
 	while ( !glfwWindowShouldClose( window ) ) {
+		ProfileScope frame_scope(profiler,ph_frame);
 		auto t_now = std::chrono::high_resolution_clock::now();
         float time = std::chrono::duration_cast<std::chrono::duration<float>>(t_now - t_start).count();
+		if (recording){
+			time = frames_recorded/record_fps;
+		}
 		// wipe the drawing surface clear
-		glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
-		glViewport( 0, 0, g_gl_width, g_gl_height );
+		{
+			ProfileScope scope(profiler,ph_clear);
+			if (recording){
+				recorder.bind();
+			} else {
+				glViewport( 0, 0, g_gl_width, g_gl_height );
+			}
+			glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+		}
+
+		if (replay_path){
+			const TrajRecord &rec = replay[replay.findTime(time)];
+			sphere1.setPosition(glm::vec3(rec.position[0],rec.position[1],rec.position[2]));
+			sphere1.setVelocity(glm::vec3(rec.velocity[0],rec.velocity[1],rec.velocity[2]));
+			render_position = sphere1.getPosition();
+		} else {
+			// latest published steps, blended by how far the next step is along
+			ProfileScope scope(profiler,ph_handoff);
+			if (recording && frames_recorded > 0){
+				run_steps(scheduler.advance(1.0f/record_fps));
+			}
+			frames.update();
+			const SimFrame &f = frames.readBuffer();
+			float alpha = std::chrono::duration_cast<std::chrono::duration<float>>(std::chrono::steady_clock::now() - f.time).count()/physics_dt;
+			if (recording){
+				alpha = scheduler.getAlpha();
+			}
+			alpha = std::min(std::max(alpha,0.0f),1.0f);
+			render_position = glm::mix(f.pendulum[0],f.pendulum[1],alpha);
+			for (int i = 0; i < ensemble_size; ++i){
+				ensemble_render[i] = glm::mix(f.ensemble[0][i],f.ensemble[1][i],alpha);
+				ensemble_render[i].y = ensemble_size > 1 ? -2.0f + 4.0f*i/(ensemble_size - 1) : 0.0f;
+			}
+			for (size_t i = 0; i < chain_render.size(); ++i){
+				chain_render[i] = glm::mix(f.chain[0][i],f.chain[1][i],alpha);
+			}
+		}
 
-		glm::mat4 model = glm::mat4(1.0f);
-		glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(model)); //sets the uniform matrix model in shader
-		plane1.draw();
-		line1.init(vp,puntofijo,sphere1.getPosition());
-		line1.draw();
+		// the camera and every model matrix of the frame, one upload each;
+		// the projection is rebuilt from the current size, so resizes apply
+		int object_identity, object_sphere, object_chain = 0;
+		{
+			ProfileScope scope(profiler,ph_transforms);
+			glm::mat4 proj = glm::perspective(
+				glm::radians(45.0f),
+				g_gl_width / g_gl_height,
+				1.0f,
+				20.0f
+			);
+			camera.update(view,proj);
+			objects.clear();
+			object_identity = objects.add(glm::mat4(1.0f));
+			object_sphere = objects.add(render_position);
+			for (int i = 0; i < chain_links; ++i){
+				int index = objects.add(chain_render[i+1]);
+				if (i == 0){
+					object_chain = index;
+				}
+			}
+			objects.upload();
+		}
 
-		IntegrateRK4(sphere1,frame_time);
-		//CheckBC(sphere1);
+		glUniform1i(uniObjectBase, object_identity);
+		{
+			ProfileScope scope(profiler,ph_plane);
+			plane1.draw();
+		}
+		{
+			ProfileScope scope(profiler,ph_line);
+			rods.clear();
+			rods.push_back(puntofijo);
+			rods.push_back(render_position);
+			for (int i = 0; i < ensemble_size; ++i){
+				rods.push_back(glm::vec3(puntofijo.x,ensemble_render[i].y,puntofijo.z));
+				rods.push_back(ensemble_render[i]);
+			}
+			for (int i = 0; i < chain_links; ++i){
+				rods.push_back(chain_render[i]);
+				rods.push_back(chain_render[i+1]);
+			}
+			line1.update(&rods[0],rods.size()/2);
+			line1.draw();
+		}
 				
-		glm::mat4 model1 = glm::mat4(1.0f);
-		model1 = glm::translate(
-            model1,
-            sphere1.getPosition()
-        );
+		glUniform1i(uniObjectBase, object_sphere);
+		// coarser mesh when the sphere covers few pixels
+		sphere1.setLod(pickSphereLod(projectedRadius(R, glm::distance(eye, render_position), glm::radians(45.0f), g_gl_height)));
+		{
+			ProfileScope scope(profiler,ph_sphere);
+			sphere1.draw();
+		}
 
-		
-		
-    	glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(model1)); //sets the uniform matrix model in shader
-		sphere1.draw();
+		if (chain_links > 0){
+			ProfileScope scope(profiler,ph_chain);
+			glUniform1i(uniObjectBase, object_chain);
+			chain_sphere.drawInstanced(chain_links);
+		}
+
+		if (ensemble_size > 0){
+			ProfileScope scope(profiler,ph_ensemble);
+			glUseProgram( instanced_programme );
+			instancer.update(&ensemble_render[0], ensemble_size);
+			instancer.draw();
+			glUseProgram( shader_programme );
+		}
 
 		// update other events like input handling
-		glfwPollEvents();
+		{
+			ProfileScope scope(profiler,ph_poll);
+			glfwPollEvents();
+		}
 		if ( GLFW_PRESS == glfwGetKey( window, GLFW_KEY_ESCAPE ) ) {
 			glfwSetWindowShouldClose( window, 1 );
 		}
+		// P prints the latency summary so far
+		bool summary_key = GLFW_PRESS == glfwGetKey( window, GLFW_KEY_P );
+		if (summary_key && !summary_key_down){
+			profiler.printSummary(std::cout);
+		}
+		summary_key_down = summary_key;
 		
-		// put the stuff we've been drawing onto the display
-		glfwSwapBuffers( window );
+		// put the stuff we've been drawing onto the display, or read it
+		// back when recording
+		if (recording){
+			ProfileScope scope(profiler,ph_record);
+			if (!recorder.capture()){
+				std::cerr << "cannot write frames to " << (record_path ? record_path : record_pipe) << std::endl;
+				glfwSetWindowShouldClose( window, 1 );
+			}
+			if (++frames_recorded >= record_frames){
+				glfwSetWindowShouldClose( window, 1 );
+			}
+		} else {
+			ProfileScope scope(profiler,ph_swap);
+			glfwSwapBuffers( window );
+		}
 		auto t_after_frame_display = std::chrono::high_resolution_clock::now();
 		frame_time = std::chrono::duration_cast<std::chrono::duration<float>>(t_after_frame_display - t_now).count();
 		fps = 1/frame_time;
 		frame_time_cummulated += frame_time;
 
-		log_file.open(GL_LOG_FILE,std::ios::app);
-		log_file << "t_now: " << t_now << std::endl;
-		log_file << "t_after_frame_display: " << t_after_frame_display << std::endl;
-		log_file << "frame_time: " << frame_time << std::endl;
-		log_file << "fps: " << fps << std::endl;
-		log_file << "time: " << time <<  std::endl;
-		log_file.close();
+		FrameRecord frame_record = { t_now, t_after_frame_display, frame_time, fps, time };
+		frame_log.push(frame_record);
 		if (frame_time_cummulated >= 1.0f){
 			std::string fps_title[] = {"OpenGL @ FPS: "};
 			fps_title[0].append(std::to_string(fps));
@@ -458,10 +850,46 @@ int main() {
 		
 	}
 
-	// close GL context and any other GLFW resources
-	glfwTerminate();
+	if (sim_thread.joinable()){
+		sim_running.store(false, std::memory_order_release);
+		sim_thread.join();
+	}
+
+	if (recording){
+		if (!recorder.finish()){
+			std::cerr << "cannot write frames to " << (record_path ? record_path : record_pipe) << std::endl;
+		}
+		double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - t_record_start).count();
+		std::cout << "recorded " << recorder.getFrames() << " frames of " << record_width << "x" << record_height
+		          << " in " << seconds << " s, " << recorder.getFrames()/seconds << " frames/s" << std::endl;
+		recorder.cleanup();
+		recorder.close();
+	}
+
+	// GL objects go while their context is still current
 	sphere1.cleanup();
 	plane1.cleanup();
 	line1.cleanup();
+	objects.cleanup();
+	camera.cleanup();
+	instancer.cleanup();
+	chain_sphere.cleanup();
+	// close GL context and any other GLFW resources
+	glfwTerminate();
+	checkpoint.close();
+	stopPhysicsLog();
+	frame_log.cleanup();
+	if (!profiler.dump(profile_path)){
+		std::cerr << "cannot write " << profile_path << std::endl;
+	} else if (!replay_path){
+		std::ofstream profile_file(profile_path,std::ios::app);
+		profile_file << "simulation thread:" << std::endl;
+		sim_profiler.printSummary(profile_file);
+		profile_file << "conservation:" << std::endl;
+		monitor.printReport(profile_file);
+	}
+	if (scheduler.getDroppedSteps() > 0){
+		std::cout << "physics fell behind, dropped " << scheduler.getDroppedSteps() << " steps" << std::endl;
+	}
 	return 0;
 }
\ No newline at end of file
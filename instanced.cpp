@@ -0,0 +1,103 @@
+#include "instanced.hpp"
+
+#include <iostream>
+
+SphereInstancer::SphereInstancer()
+{
+    isInited = false;
+    mesh = 0;
+    instanced_vao = 0;
+    instanced_vboOffset = 0;
+    maxInstances = 0;
+    numInstances = 0;
+
+    sectorCount = 36;
+    stackCount = 18;
+}
+
+SphereInstancer::~SphereInstancer()
+{
+
+}
+
+void SphereInstancer::init(GLuint vertexPositionID, GLuint offsetID, float radius, int instances,
+                           int sectors, int stacks)
+{
+    if (isInited) {
+        cleanup();
+    }
+    sectorCount = sectors;
+    stackCount = stacks;
+    mesh = sharedMeshCache().acquireSphere(vertexPositionID, radius, sectorCount, stackCount);
+
+    // the mesh's own VAO has no instance attribute, so build one around its buffers
+    glGenVertexArrays(1, &instanced_vao);
+    glBindVertexArray(instanced_vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vboVertex);
+    glVertexAttribPointer(vertexPositionID, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+    glEnableVertexAttribArray (vertexPositionID);
+
+    glGenBuffers(1, &instanced_vboOffset);
+    glBindBuffer(GL_ARRAY_BUFFER, instanced_vboOffset);
+    glBufferData(GL_ARRAY_BUFFER, instances * sizeof(glm::vec3), NULL, GL_STREAM_DRAW);
+
+    glVertexAttribPointer(offsetID, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+    glEnableVertexAttribArray (offsetID);
+    glVertexAttribDivisor(offsetID, 1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->vboIndex);
+
+    glBindVertexArray(0);
+
+    maxInstances = instances;
+    numInstances = 0;
+
+    isInited = true;
+}
+
+void SphereInstancer::cleanup()
+{
+    if (!isInited) {
+        return;
+    }
+    if(instanced_vboOffset) {
+        glDeleteBuffers(1, &instanced_vboOffset);
+    }
+    if (instanced_vao) {
+        glDeleteVertexArrays(1, &instanced_vao);
+    }
+    if (mesh) {
+        sharedMeshCache().release(mesh);
+    }
+
+    isInited = false;
+    mesh = 0;
+    instanced_vao = 0;
+    instanced_vboOffset = 0;
+}
+
+void SphereInstancer::update(const glm::vec3 *positions, int count)
+{
+    if (count > maxInstances) {
+        count = maxInstances;
+    }
+    numInstances = count;
+    glBindBuffer(GL_ARRAY_BUFFER, instanced_vboOffset);
+    // orphan last frame's storage so the upload never waits on the GPU
+    glBufferData(GL_ARRAY_BUFFER, maxInstances * sizeof(glm::vec3), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::vec3), positions);
+}
+
+void SphereInstancer::draw()
+{
+    if (!isInited) {
+        std::cout << "please call init() before draw()" << std::endl;
+        return;
+    }
+
+    // draw all instances at once
+    glPolygonMode(GL_FRONT_AND_BACK,GL_LINE);
+    glBindVertexArray(instanced_vao);
+    glDrawElementsInstanced(GL_TRIANGLES, mesh->numsToDraw, GL_UNSIGNED_INT, NULL, numInstances);
+}
@@ -0,0 +1,34 @@
+#ifndef INSTANCED_H
+#define INSTANCED_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "meshcache.hpp"
+
+// Draws many spheres of the same radius with one shared mesh and a single
+// glDrawElementsInstanced call. Each instance only contributes a translation,
+// read by the vertex shader from a per-instance attribute (divisor 1). The
+// vertex and index buffers come from sharedMeshCache(); only the VAO and the
+// per-instance buffer belong to the instancer.
+class SphereInstancer
+{
+public:
+    SphereInstancer();
+    ~SphereInstancer();
+    void init(GLuint vertexPositionID, GLuint offsetID, float radius, int maxInstances,
+              int sectors = 36, int stacks = 18);
+    void cleanup();
+    // uploads the translations of this frame's instances in one call
+    void update(const glm::vec3 *positions, int count);
+    void draw();
+
+private:
+    int sectorCount, stackCount;
+    bool isInited;
+    const GpuMesh *mesh;
+    GLuint instanced_vao, instanced_vboOffset;
+    int maxInstances;
+    int numInstances;
+};
+
+#endif // INSTANCED_H
@@ -0,0 +1,263 @@
+#ifndef INTEGRATORS_H
+#define INTEGRATORS_H
+
+#include <utility>
+#include <glm/glm.hpp>
+#include "physics.hpp"
+#include "fastmath.hpp"
+
+// Compile-time integrators for x'' = f(x, x'). The scheme is a type, so a
+// loop over steps is instantiated once per scheme and force model and the
+// stages are expanded inline with no run-time dispatch. Vec is any type with
+// +, - and scalar * (glm::vec3, float, vfloat...). Forces are functors
+// Vec operator()(const Vec &x, const Vec &v) const.
+//
+// Explicit Runge-Kutta schemes are generated from a Butcher tableau; adding
+// one only needs a new tableau struct. Symplectic schemes are separate
+// policies because they are not of that form.
+
+// Position, velocity and the acceleration f(x, v) at that state. Every scheme
+// leaves a consistent a behind so the next step can reuse it as its first
+// stage, the way IntegrateVerlet reuses the body's stored acceleration.
+template<typename Vec>
+struct PhaseState
+{
+    Vec x, v, a;
+};
+
+// Butcher tableaus. a is strictly lower triangular for explicit methods.
+struct EulerTableau
+{
+    static constexpr int stages = 1;
+    static constexpr double a[1][1] = { { 0 } };
+    static constexpr double b[1] = { 1 };
+};
+
+struct MidpointTableau
+{
+    static constexpr int stages = 2;
+    static constexpr double a[2][2] = { { 0, 0 }, { 0.5, 0 } };
+    static constexpr double b[2] = { 0, 1 };
+};
+
+struct HeunTableau
+{
+    static constexpr int stages = 2;
+    static constexpr double a[2][2] = { { 0, 0 }, { 1, 0 } };
+    static constexpr double b[2] = { 0.5, 0.5 };
+};
+
+// Kutta's third order method
+struct RK3Tableau
+{
+    static constexpr int stages = 3;
+    static constexpr double a[3][3] = { { 0, 0, 0 }, { 0.5, 0, 0 }, { -1, 2, 0 } };
+    static constexpr double b[3] = { 1.0/6, 4.0/6, 1.0/6 };
+};
+
+struct RK4Tableau
+{
+    static constexpr int stages = 4;
+    static constexpr double a[4][4] = { { 0, 0, 0, 0 }, { 0.5, 0, 0, 0 }, { 0, 0.5, 0, 0 }, { 0, 0, 1, 0 } };
+    static constexpr double b[4] = { 1.0/6, 2.0/6, 2.0/6, 1.0/6 };
+};
+
+namespace integrators_detail
+{
+    // adds dt*a[I][J]*k[J] to the stage state; zero coefficients generate no code
+    template<typename T, int I, int J, typename Vec>
+    inline void stageTerm(Vec &xi, Vec &vi, const Vec *kx, const Vec *kv, float dt)
+    {
+        if constexpr (T::a[I][J] != 0) {
+            const float h = float(T::a[I][J]) * dt;
+            xi = xi + kx[J] * h;
+            vi = vi + kv[J] * h;
+        }
+    }
+
+    template<typename T, int I, typename Vec, typename Force, std::size_t... J>
+    inline void stage(const PhaseState<Vec> &s, Vec *kx, Vec *kv, float dt, const Force &force,
+                      std::index_sequence<J...>)
+    {
+        if constexpr (I == 0) {
+            // explicit first stage is the current state, whose acceleration is known
+            kx[0] = s.v;
+            kv[0] = s.a;
+        } else {
+            Vec xi = s.x;
+            Vec vi = s.v;
+            (stageTerm<T, I, J>(xi, vi, kx, kv, dt), ...);
+            kx[I] = vi;
+            kv[I] = force(xi, vi);
+        }
+    }
+
+    template<typename T, int J, typename Vec>
+    inline void weightTerm(PhaseState<Vec> &s, const Vec *kx, const Vec *kv, float dt)
+    {
+        if constexpr (T::b[J] != 0) {
+            const float h = float(T::b[J]) * dt;
+            s.x = s.x + kx[J] * h;
+            s.v = s.v + kv[J] * h;
+        }
+    }
+
+    template<typename T, typename Vec, typename Force, std::size_t... I>
+    inline void rkStep(PhaseState<Vec> &s, float dt, const Force &force, std::index_sequence<I...>)
+    {
+        Vec kx[T::stages];
+        Vec kv[T::stages];
+        (stage<T, int(I)>(s, kx, kv, dt, force, std::make_index_sequence<I>()), ...);
+        (weightTerm<T, int(I)>(s, kx, kv, dt), ...);
+        s.a = force(s.x, s.v);
+    }
+}
+
+// explicit Runge-Kutta scheme generated from tableau T: T::stages - 1 force
+// evaluations for the stages plus one for the new state
+template<typename T>
+struct ExplicitRK
+{
+    template<typename Vec, typename Force>
+    static inline void step(PhaseState<Vec> &s, float dt, const Force &force)
+    {
+        integrators_detail::rkStep<T>(s, dt, force, std::make_index_sequence<T::stages>());
+    }
+};
+
+typedef ExplicitRK<EulerTableau> Euler;
+typedef ExplicitRK<MidpointTableau> Midpoint;
+typedef ExplicitRK<HeunTableau> Heun;
+typedef ExplicitRK<RK3Tableau> RK3;
+typedef ExplicitRK<RK4Tableau> RK4;
+
+// Symplectic schemes assume the force depends on position only. The pendulum
+// force also has a velocity term (the centripetal pull), which they evaluate
+// with the latest velocity available, like IntegrateVerlet.
+
+// velocity Verlet, one force evaluation per step
+struct VelocityVerlet
+{
+    template<typename Vec, typename Force>
+    static inline void step(PhaseState<Vec> &s, float dt, const Force &force)
+    {
+        s.x = s.x + s.v * dt + s.a * (0.5f * dt * dt);
+        Vec a1 = force(s.x, s.v);
+        s.v = s.v + (s.a + a1) * (0.5f * dt);
+        s.a = a1;
+    }
+};
+
+// Leapfrog (kick-drift-kick) substeps of weights W... applied in sequence.
+// One weight is plain leapfrog; the symmetric triple below is Yoshida's
+// fourth order composition.
+template<typename W>
+struct Composition
+{
+    template<typename Vec, typename Force, std::size_t... I>
+    static inline void run(PhaseState<Vec> &s, float dt, const Force &force, std::index_sequence<I...>)
+    {
+        ((kickDriftKick(s, float(W::w[I]) * dt, force)), ...);
+    }
+
+    template<typename Vec, typename Force>
+    static inline void kickDriftKick(PhaseState<Vec> &s, float h, const Force &force)
+    {
+        s.v = s.v + s.a * (0.5f * h);
+        s.x = s.x + s.v * h;
+        s.a = force(s.x, s.v);
+        s.v = s.v + s.a * (0.5f * h);
+    }
+
+    template<typename Vec, typename Force>
+    static inline void step(PhaseState<Vec> &s, float dt, const Force &force)
+    {
+        run(s, dt, force, std::make_index_sequence<W::count>());
+    }
+};
+
+struct LeapfrogWeights
+{
+    static constexpr int count = 1;
+    static constexpr double w[1] = { 1 };
+};
+
+// w1 = 1/(2 - 2^(1/3)), w0 = -2^(1/3)/(2 - 2^(1/3))
+struct Yoshida4Weights
+{
+    static constexpr int count = 3;
+    static constexpr double w[3] = { 1.3512071919596578, -1.7024143839193155, 1.3512071919596578 };
+};
+
+typedef Composition<LeapfrogWeights> Leapfrog;
+typedef Composition<Yoshida4Weights> Yoshida4;
+
+// The pendulum force of updateAcceleration as a functor, without the log and
+// without touching a Body. The mass cancels out of the acceleration. fast
+// selects the fastmath.hpp polynomials, normally from getFastTrig().
+struct PendulumForce
+{
+    PendulumParams p;
+    bool fast;
+
+    glm::vec3 operator()(const glm::vec3 &x, const glm::vec3 &v) const
+    {
+        float theta, s, c;
+        if (fast) {
+            theta = fastAtan((x.x - p.puntofijo.x) / (p.puntofijo.z - x.z));
+            fastSincos(theta, s, c);
+        } else {
+            theta = glm::atan((x.x - p.puntofijo.x) / (p.puntofijo.z - x.z));
+            s = glm::sin(theta);
+            c = glm::cos(theta);
+        }
+        float fn = -glm::dot(v, v) / p.L;
+        float ft = -p.gravity * s;
+        return glm::vec3(fn * s + ft * c, 0.0f, -fn * c + ft * s);
+    }
+};
+
+// steps a Body with scheme S under the pendulum force; the body's stored
+// acceleration must be current, as after initPendulum
+template<typename S>
+inline void IntegrateBody(Body &sphere, float DT, const PendulumParams &p = defaultParams)
+{
+    PendulumForce force = { p, getFastTrig() };
+    PhaseState<glm::vec3> s = { sphere.getPosition(), sphere.getVelocity(), sphere.getAcceleration() };
+    S::step(s, DT, force);
+    sphere.setPosition(s.x);
+    sphere.setVelocity(s.v);
+    sphere.setAcceleration(s.a);
+}
+
+// The same pendulum in generalised coordinates: x is the angle theta from the
+// vertical and v is omega. The rod length is exact by construction and each
+// evaluation costs one sine instead of an atan, a sine and a cosine.
+struct AngularPendulumForce
+{
+    float gravity, L;
+    bool fast;
+
+    float operator()(float theta, float /*omega*/) const
+    {
+        return -gravity / L * (fast ? fastSin(theta) : glm::sin(theta));
+    }
+};
+
+// angle state at rest at theta, with its angular acceleration
+inline PhaseState<float> initAngle(float theta = theta0, const PendulumParams &p = defaultParams)
+{
+    AngularPendulumForce force = { p.gravity, p.L, getFastTrig() };
+    PhaseState<float> s = { theta, 0.0f, force(theta, 0.0f) };
+    return s;
+}
+
+// steps an angle state with scheme S; convert with setPendulumAngle to draw it
+template<typename S>
+inline void IntegrateAngle(PhaseState<float> &s, float DT, const PendulumParams &p = defaultParams)
+{
+    AngularPendulumForce force = { p.gravity, p.L, getFastTrig() };
+    S::step(s, DT, force);
+}
+
+#endif // INTEGRATORS_H
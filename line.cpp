@@ -1,19 +1,14 @@
 #include "line.hpp"
 
-#include <vector>
 #include <iostream>
-#include <fstream>
-#include <glm/gtc/matrix_inverse.hpp>
-#include <glm/gtc/type_ptr.hpp>
-#include <glm/gtx/string_cast.hpp>
 
 Line::Line()
 {
     isInited = false;
     line_vao = 0;
     line_vboVertex = 0;
-    line_vboIndex = 0;
-
+    maxSegments = 0;
+    numsToDraw = 0;
 }
 
 Line::~Line()
@@ -21,44 +16,56 @@ Line::~Line()
 
 }
 
-void Line::init(GLuint vertexPositionID, glm::vec3 a, glm::vec3 b)
+void Line::init(GLuint vertexPositionID, int segments)
 {
-    
-    std::vector<GLfloat> vertices;
-    std::vector<GLuint> indices;
-       
-    vertices.push_back(a.x);
-    vertices.push_back(a.y);
-    vertices.push_back(a.z);
-
-    vertices.push_back(b.x);
-    vertices.push_back(b.y);
-    vertices.push_back(b.z);
-           
-    indices.push_back(0);
-    indices.push_back(1);
-    
+    if (isInited) {
+        cleanup();
+    }
+
     glGenVertexArrays(1, &line_vao);
     glBindVertexArray(line_vao);
 
     glGenBuffers(1, &line_vboVertex);
     glBindBuffer(GL_ARRAY_BUFFER, line_vboVertex);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), &vertices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, 2 * segments * sizeof(glm::vec3), NULL, GL_STREAM_DRAW);
 
     glVertexAttribPointer(vertexPositionID, 3, GL_FLOAT, GL_FALSE, 0, NULL);
     glEnableVertexAttribArray (vertexPositionID);
 
-    glGenBuffers(1, &line_vboIndex);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, line_vboIndex);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
-
     glBindVertexArray(0);
 
-    numsToDraw = indices.size();
-    
+    maxSegments = segments;
+    numsToDraw = 0;
+
     isInited = true;
 }
 
+void Line::init(GLuint vertexPositionID, glm::vec3 a, glm::vec3 b)
+{
+    if (!isInited) {
+        init(vertexPositionID, 1);
+    }
+    update(a, b);
+}
+
+void Line::update(const glm::vec3 *endpoints, int segments)
+{
+    if (segments > maxSegments) {
+        segments = maxSegments;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, line_vboVertex);
+    // orphan the old storage so the driver need not wait for draws still using it
+    glBufferData(GL_ARRAY_BUFFER, 2 * maxSegments * sizeof(glm::vec3), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, 2 * segments * sizeof(glm::vec3), endpoints);
+    numsToDraw = 2 * segments;
+}
+
+void Line::update(glm::vec3 a, glm::vec3 b)
+{
+    glm::vec3 endpoints[2] = { a, b };
+    update(endpoints, 1);
+}
+
 void Line::cleanup()
 {
     if (!isInited) {
@@ -67,9 +74,6 @@ void Line::cleanup()
     if(line_vboVertex) {
         glDeleteBuffers(1, &line_vboVertex);
     }
-    if(line_vboIndex) {
-        glDeleteBuffers(1, &line_vboIndex);
-    }
     if (line_vao) {
         glDeleteVertexArrays(1, &line_vao);
     }
@@ -77,7 +81,6 @@ void Line::cleanup()
     isInited = false;
     line_vao = 0;
     line_vboVertex = 0;
-    line_vboIndex = 0;
 }
 
 void Line::draw()
@@ -86,8 +89,8 @@ void Line::draw()
         std::cout << "please call init() before draw()" << std::endl;
     }
 
-    // draw line
+    // draw lines
     glPolygonMode(GL_FRONT_AND_BACK,GL_LINE);
     glBindVertexArray(line_vao);
-    glDrawElements(GL_LINES, numsToDraw, GL_UNSIGNED_INT, NULL);
-}
\ No newline at end of file
+    glDrawArrays(GL_LINES, 0, numsToDraw);
+}
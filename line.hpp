@@ -4,19 +4,29 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+// Batch of line segments whose endpoints change every frame. The VAO and
+// vertex buffer are created once in init(); update() re-specifies the buffer
+// storage (orphaning) and uploads all endpoints with one call, so nothing is
+// allocated or leaked per frame.
 class Line
 {
 public:
     Line();
     ~Line();
+    void init(GLuint vertexPositionID, int maxSegments);
+    // single segment from a to b; on an initialised line this only updates it
     void init(GLuint vertexPositionID, glm::vec3 a, glm::vec3 b);
+    // endpoints holds 2*segments points, a0 b0 a1 b1 ...
+    void update(const glm::vec3 *endpoints, int segments);
+    void update(glm::vec3 a, glm::vec3 b);
     void cleanup();
     void draw();
 
 private:
     bool isInited;
-    GLuint line_vao, line_vboVertex, line_vboIndex;
+    GLuint line_vao, line_vboVertex;
+    int maxSegments;
     int numsToDraw;
 };
 
-#endif // LINE_H
\ No newline at end of file
+#endif // LINE_H
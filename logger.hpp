@@ -0,0 +1,137 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Asynchronous text log. The hot path copies a plain Record into a lock-free
+// single-producer/single-consumer ring; a background thread formats whole
+// batches of records and writes them with one call. When the ring is full the
+// record is dropped and counted, the producer never blocks.
+//
+// Define NO_LOG to compile every push() out, or call setEnabled(false) to
+// skip at run time. setSampling(n) keeps only every n-th record.
+template <typename Record>
+class AsyncLogger
+{
+public:
+    typedef void (*Formatter)(std::string &out, const Record &rec);
+
+    AsyncLogger() : format(0), mask(0), head(0), tail(0), dropped(0),
+                    running(false), enabled(false), sampling(1), counter(0) {}
+    ~AsyncLogger() { cleanup(); }
+
+    // capacity is rounded up to a power of two
+    bool init(const char *path, Formatter formatter, bool append = true, size_t capacity = 8192)
+    {
+        cleanup();
+        file.open(path, append ? std::ios::app : std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        ring.resize(size);
+        mask = size - 1;
+        format = formatter;
+        head.store(0);
+        tail.store(0);
+        dropped.store(0);
+        counter = 0;
+        running.store(true);
+        writer = std::thread(&AsyncLogger::writerLoop, this);
+        enabled.store(true);
+        return true;
+    }
+
+    // drains everything still queued, then stops the writer and closes the file
+    void cleanup()
+    {
+        enabled.store(false);
+        if (writer.joinable()) {
+            running.store(false, std::memory_order_release);
+            writer.join();
+        }
+        if (file.is_open()) {
+            file.close();
+        }
+    }
+
+    void setEnabled(bool on) { enabled.store(on && writer.joinable(), std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+    void setSampling(unsigned n) { sampling = n > 0 ? n : 1; }
+    unsigned long long getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+    // producer side, called from a single thread only
+    void push(const Record &rec)
+    {
+#ifndef NO_LOG
+        if (!enabled.load(std::memory_order_relaxed)) {
+            return;
+        }
+        if (sampling > 1 && (counter++ % sampling) != 0) {
+            return;
+        }
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) > mask) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        ring[h & mask] = rec;
+        head.store(h + 1, std::memory_order_release);
+#else
+        (void)rec;
+#endif
+    }
+
+private:
+    static const size_t batchSize = 1024;
+
+    void writerLoop()
+    {
+        std::string buffer;
+        for (;;) {
+            bool stopping = !running.load(std::memory_order_acquire);
+            size_t t = tail.load(std::memory_order_relaxed);
+            size_t h = head.load(std::memory_order_acquire);
+            if (t == h) {
+                if (stopping) {
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            if (h - t > batchSize) {
+                h = t + batchSize;
+            }
+            buffer.clear();
+            for (; t != h; ++t) {
+                format(buffer, ring[t & mask]);
+            }
+            tail.store(t, std::memory_order_release);
+            file.write(buffer.data(), buffer.size());
+        }
+        file.flush();
+    }
+
+    Formatter format;
+    std::vector<Record> ring;
+    size_t mask;
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+    std::atomic<unsigned long long> dropped;
+    std::atomic<bool> running;
+    std::atomic<bool> enabled;
+    unsigned sampling;
+    unsigned long long counter;
+    std::thread writer;
+    std::ofstream file;
+};
+
+#endif // LOGGER_H
@@ -0,0 +1,109 @@
+#include "mesh.hpp"
+
+#include <cmath>
+#include <glm/glm.hpp>
+
+void buildSphereMesh(float radius, int sectorCount, int stackCount,
+                     std::vector<float> &vertices, std::vector<unsigned int> &indices)
+{
+    float x, y, z, xy;                              // vertex position
+
+    float sectorStep = 2 * glm::pi<double>() / sectorCount;
+    float stackStep = glm::pi<double>() / stackCount;
+    float sectorAngle, stackAngle;
+
+    vertices.clear();
+    indices.clear();
+    vertices.reserve((stackCount + 1) * (sectorCount + 1) * 3);
+    indices.reserve((stackCount - 1) * sectorCount * 6);
+
+    for(int i = 0; i <= stackCount; ++i)
+    {
+    stackAngle = glm::pi<double>() / 2 - i * stackStep;        // starting from pi/2 to -pi/2
+    xy = radius * cosf(stackAngle);             // r * cos(u)
+    z = radius * sinf(stackAngle);              // r * sin(u)
+
+    // add (sectorCount+1) vertices per stack
+    // the first and last vertices have same position, so the seam closes
+    for(int j = 0; j <= sectorCount; ++j)
+        {
+        sectorAngle = j * sectorStep;           // starting from 0 to 2pi
+
+        // vertex position (x, y, z)
+        x = xy * cosf(sectorAngle);             // r * cos(u) * cos(v)
+        y = xy * sinf(sectorAngle);             // r * cos(u) * sin(v)
+        vertices.push_back(x);
+        vertices.push_back(y);
+        vertices.push_back(z);
+        }
+    }
+
+    int k1, k2;
+    for(int i = 0; i < stackCount; ++i)
+    {
+    k1 = i * (sectorCount + 1);     // beginning of current stack
+    k2 = k1 + sectorCount + 1;      // beginning of next stack
+
+    for(int j = 0; j < sectorCount; ++j, ++k1, ++k2)
+        {
+        // 2 triangles per sector excluding first and last stacks
+        // k1 => k2 => k1+1
+        if(i != 0)
+            {
+            indices.push_back(k1);
+            indices.push_back(k2);
+            indices.push_back(k1 + 1);
+            }
+
+        // k1+1 => k2 => k2+1
+        if(i != (stackCount-1))
+            {
+            indices.push_back(k1 + 1);
+            indices.push_back(k2);
+            indices.push_back(k2 + 1);
+            }
+        }
+    }
+}
+
+void buildPlaneMesh(float z0, int divsx, int divsy,
+                    std::vector<float> &vertices, std::vector<unsigned int> &indices)
+{
+    vertices.clear();
+    indices.clear();
+    vertices.reserve((2 * divsx + 1) * (2 * divsy + 1) * 3);
+    indices.reserve(2 * divsx * 2 * divsy * 6);
+
+    for(int i = -divsx; i <= divsx; ++i) {
+       
+       for(int j = -divsy; j <= divsy; ++j) {
+           double x = j;
+           double y = i;
+           double z = z0;
+           vertices.push_back(x);
+           vertices.push_back(y);
+           vertices.push_back(z);
+           
+        }
+    }
+
+    for (int r=0; r< 2*divsx; r++)
+    {
+    //Set idx to point at first vertex of row r
+        int idx=r*(2*divsx+1);
+
+        for (int c=0; c< 2*divsy; c++)
+        {        
+          //Bottom triangle of the quad
+          indices.push_back(idx);
+          indices.push_back(idx+1);
+          indices.push_back(idx+2*divsx+1);
+          //Top triangle of the quad
+          indices.push_back(idx+1);
+          indices.push_back(idx+2*divsx+2);
+          indices.push_back(idx+2*divsx+1);
+          //Move one vertex to the right
+          idx++;
+        }
+    }
+}
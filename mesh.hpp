@@ -0,0 +1,19 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <vector>
+
+// CPU-side geometry generation, free of GL so it can be shared and measured
+// on its own. Vertices are packed x,y,z; indices describe GL_TRIANGLES.
+
+// UV sphere centred on the origin, sectorCount slices around z and stackCount
+// rings from pole to pole
+void buildSphereMesh(float radius, int sectorCount, int stackCount,
+                     std::vector<float> &vertices, std::vector<unsigned int> &indices);
+
+// grid of (2*divsx+1) x (2*divsy+1) vertices one unit apart at height z0,
+// centred on the origin, as drawn by Plane
+void buildPlaneMesh(float z0, int divsx, int divsy,
+                    std::vector<float> &vertices, std::vector<unsigned int> &indices);
+
+#endif // MESH_H
@@ -0,0 +1,113 @@
+#include "meshcache.hpp"
+#include "mesh.hpp"
+
+#include <vector>
+#include <cmath>
+#include <tuple>
+
+bool MeshCache::Key::operator<(const Key &o) const
+{
+    return std::tie(vertexPositionID, radius, sectors, stacks) <
+           std::tie(o.vertexPositionID, o.radius, o.sectors, o.stacks);
+}
+
+MeshCache::MeshCache()
+{
+
+}
+
+MeshCache::~MeshCache()
+{
+
+}
+
+const GpuMesh *MeshCache::acquireSphere(GLuint vertexPositionID, float radius, int sectors, int stacks)
+{
+    Key key = { vertexPositionID, radius, sectors, stacks };
+    std::map<Key, GpuMesh>::iterator it = meshes.find(key);
+    if (it != meshes.end()) {
+        it->second.refs++;
+        return &it->second;
+    }
+
+    std::vector<GLfloat> vertices;
+    std::vector<GLuint> indices;
+    buildSphereMesh(radius, sectors, stacks, vertices, indices);
+
+    GpuMesh mesh;
+    glGenVertexArrays(1, &mesh.vao);
+    glBindVertexArray(mesh.vao);
+
+    glGenBuffers(1, &mesh.vboVertex);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vboVertex);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), &vertices[0], GL_STATIC_DRAW);
+
+    glVertexAttribPointer(vertexPositionID, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+    glEnableVertexAttribArray (vertexPositionID);
+
+    glGenBuffers(1, &mesh.vboIndex);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vboIndex);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+
+    mesh.numsToDraw = indices.size();
+    mesh.refs = 1;
+    return &meshes.insert(std::make_pair(key, mesh)).first->second;
+}
+
+void MeshCache::release(const GpuMesh *mesh)
+{
+    for (std::map<Key, GpuMesh>::iterator it = meshes.begin(); it != meshes.end(); ++it) {
+        if (&it->second != mesh) {
+            continue;
+        }
+        if (--it->second.refs == 0) {
+            glDeleteBuffers(1, &it->second.vboVertex);
+            glDeleteBuffers(1, &it->second.vboIndex);
+            glDeleteVertexArrays(1, &it->second.vao);
+            meshes.erase(it);
+        }
+        return;
+    }
+}
+
+void MeshCache::cleanup()
+{
+    for (std::map<Key, GpuMesh>::iterator it = meshes.begin(); it != meshes.end(); ++it) {
+        glDeleteBuffers(1, &it->second.vboVertex);
+        glDeleteBuffers(1, &it->second.vboIndex);
+        glDeleteVertexArrays(1, &it->second.vao);
+    }
+    meshes.clear();
+}
+
+int MeshCache::size() const
+{
+    return meshes.size();
+}
+
+MeshCache &sharedMeshCache()
+{
+    static MeshCache cache;
+    return cache;
+}
+
+float projectedRadius(float radius, float distance, float fovy, float viewportHeight)
+{
+    if (distance <= radius) {
+        return viewportHeight;
+    }
+    return radius / (distance * tanf(fovy / 2)) * viewportHeight / 2;
+}
+
+int pickSphereLod(float pixelRadius)
+{
+    if (pixelRadius >= 40.0f) {
+        return 0;
+    }
+    if (pixelRadius >= 10.0f) {
+        return 1;
+    }
+    return SPHERE_LOD_COUNT - 1;
+}
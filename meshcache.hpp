@@ -0,0 +1,56 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <GL/glew.h>
+#include <map>
+
+// GPU copy of a generated mesh, shared by every object that draws it
+struct GpuMesh
+{
+    GLuint vao, vboVertex, vboIndex;
+    int numsToDraw;
+    int refs;
+};
+
+// Registry of sphere meshes keyed by (attribute location, radius, sectors,
+// stacks). Each mesh is generated and uploaded the first time it is acquired
+// and freed when the last user releases it, so startup time and GPU memory
+// depend on the number of distinct meshes, not on the number of spheres.
+// Must be used from the thread that owns the GL context.
+class MeshCache
+{
+public:
+    MeshCache();
+    ~MeshCache();
+    const GpuMesh *acquireSphere(GLuint vertexPositionID, float radius, int sectors, int stacks);
+    void release(const GpuMesh *mesh);
+    // frees every mesh regardless of users
+    void cleanup();
+    int size() const;
+
+private:
+    struct Key
+    {
+        GLuint vertexPositionID;
+        float radius;
+        int sectors, stacks;
+        bool operator<(const Key &o) const;
+    };
+    std::map<Key, GpuMesh> meshes;
+};
+
+// cache used by Sphere
+MeshCache &sharedMeshCache();
+
+// sphere levels of detail, finest first
+const int SPHERE_LOD_COUNT = 3;
+const int sphereLodSectors[SPHERE_LOD_COUNT] = { 36, 18, 8 };
+const int sphereLodStacks[SPHERE_LOD_COUNT] = { 18, 9, 4 };
+
+// radius in pixels of a sphere at the given distance from the eye, for a
+// perspective projection with vertical field of view fovy (radians)
+float projectedRadius(float radius, float distance, float fovy, float viewportHeight);
+// LOD level for a projected radius: finest above 40 px, coarsest below 10 px
+int pickSphereLod(float pixelRadius);
+
+#endif // MESHCACHE_H
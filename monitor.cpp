@@ -0,0 +1,207 @@
+#include "monitor.hpp"
+
+#include <cstdio>
+#include <algorithm>
+
+ConservationMonitor::ConservationMonitor()
+{
+    params = defaultParams;
+    MonitorThresholds off = { 0.0, 0.0, 0.0, 0.0 };
+    limits = off;
+    init(0.0, 0.0, 1.0);
+}
+
+static double verticalAngularMomentum(const Body &body, const PendulumParams &p)
+{
+    glm::vec3 r = body.getPosition() - p.puntofijo;
+    glm::vec3 v = body.getVelocity();
+    return body.getMass()*((double)r.x*v.y - (double)r.y*v.x);
+}
+
+static double bodyEnergy(const Body &body, const PendulumParams &p)
+{
+    glm::vec3 v = body.getVelocity();
+    double m = body.getMass();
+    double height = (double)body.getPosition().z - ((double)p.puntofijo.z - p.L);
+    return 0.5*m*((double)v.x*v.x + (double)v.y*v.y + (double)v.z*v.z) + m*p.gravity*height;
+}
+
+void ConservationMonitor::init(const Body &body, double time, const PendulumParams &p)
+{
+    params = p;
+    double energy = bodyEnergy(body, p);
+    double amplitude = pendulumAmplitude(energy, body.getMass(), p);
+    init(energy, verticalAngularMomentum(body, p), pendulumPeriod(amplitude, p), time);
+}
+
+void ConservationMonitor::init(double energy, double angularMomentum, double T, double time)
+{
+    energy0 = energy;
+    scale = energy != 0.0 ? std::fabs(energy) : 1.0;
+    angularMomentum0 = angularMomentum;
+    period = T;
+    time0 = time;
+    sumE = sumE2 = windowSum = sumM = sumKM = CompensatedSum();
+    windowCount = 0;
+    windowEnd = period;
+    periods = 0;
+    sumK = sumK2 = 0.0;
+    // the initial state is the first sample, with no error
+    samples = 1;
+    lastTime = time;
+    lastError = 0.0;
+    lastConstraint = 0.0;
+    maxError = 0.0;
+    maxConstraint = 0.0;
+    maxAngular = 0.0;
+    alarms = 0;
+}
+
+void ConservationMonitor::setThresholds(const MonitorThresholds &thresholds)
+{
+    limits = thresholds;
+}
+
+unsigned ConservationMonitor::update(const Body &body, double time)
+{
+    glm::vec3 r = body.getPosition() - params.puntofijo;
+    double constraint = std::sqrt((double)r.x*r.x + (double)r.y*r.y + (double)r.z*r.z) - params.L;
+    return update(time, bodyEnergy(body, params), constraint, verticalAngularMomentum(body, params));
+}
+
+unsigned ConservationMonitor::update(double time, double energy, double constraintError, double angularMomentum)
+{
+    double e = (energy - energy0)/scale;
+    samples++;
+    sumE.add(e);
+    sumE2.add(e*e);
+    windowSum.add(e);
+    windowCount++;
+    lastTime = time;
+    lastError = e;
+    lastConstraint = constraintError;
+
+    double absError = std::fabs(e);
+    double absConstraint = std::fabs(constraintError);
+    double absAngular = std::fabs(angularMomentum - angularMomentum0);
+    maxError = std::max(maxError, absError);
+    maxConstraint = std::max(maxConstraint, absConstraint);
+    maxAngular = std::max(maxAngular, absAngular);
+
+    unsigned raised = 0;
+    if (limits.energyError > 0.0 && absError > limits.energyError) {
+        raised |= MONITOR_ENERGY_ERROR;
+    }
+    if (limits.constraintError > 0.0 && absConstraint > limits.constraintError) {
+        raised |= MONITOR_CONSTRAINT;
+    }
+    if (limits.angularMomentum > 0.0 && absAngular > limits.angularMomentum) {
+        raised |= MONITOR_ANGULAR_MOMENTUM;
+    }
+    if (time - time0 >= windowEnd) {
+        double k = (double)periods;
+        double mean = windowSum.value()/windowCount;
+        periods++;
+        sumK += k;
+        sumK2 += k*k;
+        sumM.add(mean);
+        sumKM.add(k*mean);
+        windowSum = CompensatedSum();
+        windowCount = 0;
+        windowEnd += period;
+        if (limits.energyDrift > 0.0 && periods >= 3 && std::fabs(drift()) > limits.energyDrift) {
+            raised |= MONITOR_ENERGY_DRIFT;
+        }
+    }
+    raised &= ~alarms;
+    alarms |= raised;
+    return raised;
+}
+
+double ConservationMonitor::drift() const
+{
+    if (periods < 2) {
+        return 0.0;
+    }
+    double n = (double)periods;
+    double skk = sumK2 - sumK*sumK/n;
+    double skm = sumKM.value() - sumK*sumM.value()/n;
+    return skm/skk;
+}
+
+MonitorStats ConservationMonitor::getStats() const
+{
+    MonitorStats s;
+    double n = (double)samples;
+    s.samples = samples;
+    s.time = lastTime;
+    s.energyError = lastError;
+    s.maxEnergyError = maxError;
+    s.meanEnergyError = sumE.value()/n;
+    s.rmsEnergyError = std::sqrt(sumE2.value()/n);
+    s.energyDrift = drift();
+    s.periods = periods;
+    s.constraintError = lastConstraint;
+    s.maxConstraintError = maxConstraint;
+    s.maxAngularMomentum = maxAngular;
+    return s;
+}
+
+void ConservationMonitor::printReport(std::ostream &out) const
+{
+    MonitorStats s = getStats();
+    char line[200];
+    snprintf(line, sizeof(line), "energy error: last %.3g  max %.3g  mean %.3g  rms %.3g\n",
+             s.energyError, s.maxEnergyError, s.meanEnergyError, s.rmsEnergyError);
+    out << line;
+    snprintf(line, sizeof(line), "energy drift: %.3g per period over %lld periods of %.4g s\n",
+             s.energyDrift, s.periods, period);
+    out << line;
+    snprintf(line, sizeof(line), "constraint error: last %.3g m  max %.3g m  angular momentum change: max %.3g\n",
+             s.constraintError, s.maxConstraintError, s.maxAngularMomentum);
+    out << line;
+    out << "alarms:";
+    if (!alarms) {
+        out << " none";
+    }
+    for (unsigned bit = 1; bit <= MONITOR_ANGULAR_MOMENTUM; bit <<= 1) {
+        if (alarms & bit) {
+            out << " " << monitorAlarmName(bit);
+        }
+    }
+    out << std::endl;
+}
+
+double pendulumAmplitude(double energy, double mass, const PendulumParams &p)
+{
+    // where all of the energy is potential
+    double c = 1.0 - energy/(mass*p.gravity*p.L);
+    return c > -1.0 ? std::acos(std::min(c, 1.0)) : 0.0;
+}
+
+double pendulumPeriod(double amplitude, const PendulumParams &p)
+{
+    // T = 2 pi sqrt(L/g) / AGM(1, cos(amplitude/2))
+    // at the top the period is infinite; fall back to the small-angle one
+    double a = 1.0, b = std::cos(0.5*amplitude);
+    if (b <= 0.0) {
+        b = 1.0;
+    }
+    for (int i = 0; i < 64 && std::fabs(a - b) > 1e-15*a; ++i) {
+        double m = 0.5*(a + b);
+        b = std::sqrt(a*b);
+        a = m;
+    }
+    return 2.0*glm::pi<double>()*std::sqrt(p.L/(double)p.gravity)/a;
+}
+
+const char *monitorAlarmName(unsigned alarm)
+{
+    switch (alarm) {
+        case MONITOR_ENERGY_DRIFT: return "energy_drift";
+        case MONITOR_ENERGY_ERROR: return "energy_error";
+        case MONITOR_CONSTRAINT: return "constraint";
+        case MONITOR_ANGULAR_MOMENTUM: return "angular_momentum";
+    }
+    return "unknown";
+}
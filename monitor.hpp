@@ -0,0 +1,121 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include <cmath>
+#include <ostream>
+#include "body.hpp"
+#include "physics.hpp"
+
+// Neumaier's variant of Kahan summation: the rounding error of each addition
+// is carried in a second term, so sums over millions of steps keep the
+// precision of a single addition. Must not be built with -ffast-math, which
+// is free to optimise the correction away.
+struct CompensatedSum
+{
+    double sum, c;
+
+    CompensatedSum() : sum(0.0), c(0.0) {}
+    void add(double x)
+    {
+        double t = sum + x;
+        if (std::fabs(sum) >= std::fabs(x)) {
+            c += (sum - t) + x;
+        } else {
+            c += (x - t) + sum;
+        }
+        sum = t;
+    }
+    double value() const { return sum + c; }
+};
+
+// alarm bits
+#define MONITOR_ENERGY_DRIFT 1u       // |drift per period| above the threshold
+#define MONITOR_ENERGY_ERROR 2u       // |relative energy error| above the threshold
+#define MONITOR_CONSTRAINT 4u         // ||r| - L| above the threshold
+#define MONITOR_ANGULAR_MOMENTUM 8u   // |change of Lz| above the threshold
+
+// 0 turns a check off
+struct MonitorThresholds
+{
+    double energyDrift;       // relative energy change per period
+    double energyError;       // relative energy error
+    double constraintError;   // metres
+    double angularMomentum;   // change of the vertical component, kg m^2/s
+};
+
+struct MonitorStats
+{
+    long long samples;
+    double time;                // simulated time of the last update
+    double energyError;         // last relative energy error
+    double maxEnergyError;
+    double meanEnergyError;
+    double rmsEnergyError;
+    double energyDrift;         // change of the mean error per period
+    long long periods;          // complete periods behind energyDrift
+    double constraintError;     // last |r| - L
+    double maxConstraintError;
+    double maxAngularMomentum;  // largest |Lz - Lz0|
+};
+
+// Tracks the quantities a pendulum run must conserve: total energy, the
+// vertical component of angular momentum about the pivot (gravity and the
+// rod exert no torque about that axis) and the rod length. Each update costs
+// a few dozen flops and no allocation, so it can run every step; the
+// statistics are running compensated sums. Most integrators make the energy
+// error oscillate within a swing, so the drift is measured on the mean error
+// of each whole period: it is the slope of a least-squares line through
+// those means, in relative energy per period, and is known once three
+// periods are complete. Alarms stay raised once set.
+class ConservationMonitor
+{
+public:
+    ConservationMonitor();
+    // reference values from the initial state; the period is that of the
+    // swing with the body's energy
+    void init(const Body &body, double time = 0.0, const PendulumParams &p = defaultParams);
+    // any other system: reference energy and Lz, and the period to use
+    void init(double energy, double angularMomentum, double period, double time = 0.0);
+    void setThresholds(const MonitorThresholds &thresholds);
+
+    // returns the alarms this update raised for the first time
+    unsigned update(const Body &body, double time);
+    unsigned update(double time, double energy, double constraintError = 0.0, double angularMomentum = 0.0);
+
+    MonitorStats getStats() const;
+    unsigned getAlarms() const { return alarms; }
+    double getPeriod() const { return period; }
+    void printReport(std::ostream &out) const;
+
+private:
+    double drift() const;
+
+    PendulumParams params;
+    MonitorThresholds limits;
+    double energy0, scale, angularMomentum0, period, time0;
+    long long samples;
+    double lastTime, lastError, lastConstraint;
+    double maxError, maxConstraint, maxAngular;
+    CompensatedSum sumE, sumE2;
+    // the period being averaged, ending at windowEnd after init
+    CompensatedSum windowSum;
+    long long windowCount;
+    double windowEnd;
+    // drift line through the mean error of period k: sums of k, k^2, mean
+    // and k*mean
+    long long periods;
+    double sumK, sumK2;
+    CompensatedSum sumM, sumKM;
+    unsigned alarms;
+};
+
+// angle from the vertical at which a pendulum with this energy (measured from
+// the lowest point) comes to rest, 0 if it goes over the top
+double pendulumAmplitude(double energy, double mass, const PendulumParams &p = defaultParams);
+// period of the pendulum swinging to the given amplitude in radians,
+// from the arithmetic-geometric mean
+double pendulumPeriod(double amplitude, const PendulumParams &p = defaultParams);
+// name of a single alarm bit
+const char *monitorAlarmName(unsigned alarm);
+
+#endif // MONITOR_H
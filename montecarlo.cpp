@@ -0,0 +1,405 @@
+#include "montecarlo.hpp"
+#include "ensemble.hpp"
+#include "threadpool.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+void RunningStats::add(double x)
+{
+    count++;
+    double delta = x - mean;
+    mean += delta/count;
+    m2 += delta*(x - mean);
+    if (count == 1) {
+        min = max = x;
+    } else {
+        min = std::min(min, x);
+        max = std::max(max, x);
+    }
+}
+
+void RunningStats::merge(const RunningStats &other)
+{
+    if (other.count == 0) {
+        return;
+    }
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    double n = (double)(count + other.count);
+    double delta = other.mean - mean;
+    mean += delta*other.count/n;
+    m2 += other.m2 + delta*delta*((double)count*other.count/n);
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    count += other.count;
+}
+
+void Histogram::init(double low, double high, int n)
+{
+    lo = low;
+    hi = high;
+    bins = n;
+    counts.assign(bins + 2, 0);
+}
+
+void Histogram::clear()
+{
+    std::fill(counts.begin(), counts.end(), 0);
+}
+
+void Histogram::add(double x)
+{
+    // NaN lands below the range
+    if (!(x >= lo)) {
+        counts[0]++;
+    } else if (x >= hi) {
+        counts[bins + 1]++;
+    } else {
+        int bin = (int)((x - lo)/(hi - lo)*bins);
+        counts[1 + std::min(bin, bins - 1)]++;
+    }
+}
+
+void Histogram::merge(const Histogram &other)
+{
+    for (size_t i = 0; i < counts.size(); ++i) {
+        counts[i] += other.counts[i];
+    }
+}
+
+double Distribution::sample(double u1, double u2) const
+{
+    switch (kind) {
+        case DIST_UNIFORM:
+            return a + (b - a)*u1;
+        case DIST_NORMAL:
+            return a + b*std::sqrt(-2.0*std::log(u1))*std::cos(2.0*glm::pi<double>()*u2);
+        default:
+            return a;
+    }
+}
+
+double Distribution::lower(double sigmas) const
+{
+    switch (kind) {
+        case DIST_UNIFORM: return std::min(a, b);
+        case DIST_NORMAL: return a - sigmas*std::fabs(b);
+        default: return a;
+    }
+}
+
+double Distribution::upper(double sigmas) const
+{
+    switch (kind) {
+        case DIST_UNIFORM: return std::max(a, b);
+        case DIST_NORMAL: return a + sigmas*std::fabs(b);
+        default: return a;
+    }
+}
+
+bool parseDistribution(const char *text, Distribution &dist, double scale)
+{
+    double a, b;
+    char tail;
+    if (strncmp(text, "uniform:", 8) == 0) {
+        if (sscanf(text + 8, "%lf:%lf%c", &a, &b, &tail) != 2) {
+            return false;
+        }
+        dist.kind = DIST_UNIFORM;
+    } else if (strncmp(text, "normal:", 7) == 0) {
+        if (sscanf(text + 7, "%lf:%lf%c", &a, &b, &tail) != 2 || b < 0.0) {
+            return false;
+        }
+        dist.kind = DIST_NORMAL;
+    } else {
+        if (sscanf(text, "%lf%c", &a, &tail) != 1) {
+            return false;
+        }
+        dist.kind = DIST_FIXED;
+        b = 0.0;
+    }
+    dist.a = a*scale;
+    dist.b = b*scale;
+    return true;
+}
+
+const char *monteCarloQuantityName(int quantity)
+{
+    switch (quantity) {
+        case MC_THETA: return "theta";
+        case MC_OMEGA: return "omega";
+        case MC_ENERGY: return "energy";
+    }
+    return "unknown";
+}
+
+MonteCarloConfig::MonteCarloConfig()
+{
+    members = 0;
+    seed = 1;
+    Distribution fixedTheta = { DIST_FIXED, ::theta0, 0.0 };
+    Distribution fixedOmega = { DIST_FIXED, 0.0, 0.0 };
+    Distribution fixedLength = { DIST_FIXED, ::L, 0.0 };
+    theta0 = fixedTheta;
+    omega0 = fixedOmega;
+    length = fixedLength;
+    mass = 1.0f;
+    gravity = ::gravity;
+    pivot = puntofijo;
+    dt = 0.001f;
+    integrator = INTEGRATOR_RK4;
+    angular = false;
+    bins = 64;
+    for (int q = 0; q < MC_QUANTITIES; ++q) {
+        range[q][0] = range[q][1] = 0.0;
+    }
+}
+
+// splitmix64 finaliser: a bijection that scrambles every input bit
+static inline uint64_t mix(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27))*0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// draw number draw of a member, uniform on (0, 1); a function of the seed
+// and its arguments only, so no generator state is shared between threads
+static inline double memberUniform(uint64_t seed, long long member, unsigned draw)
+{
+    uint64_t h = mix(seed ^ mix((uint64_t)member*256 + draw));
+    return ((h >> 11) + 0.5)*(1.0/9007199254740992.0);
+}
+
+MonteCarloEnsemble::MonteCarloEnsemble()
+{
+    isInited = false;
+    redraws = 0;
+}
+
+MonteCarloEnsemble::~MonteCarloEnsemble()
+{
+    cleanup();
+}
+
+bool MonteCarloEnsemble::init(const MonteCarloConfig &c)
+{
+    if (isInited) {
+        cleanup();
+    }
+    if (c.members <= 0 || c.dt <= 0.0f || c.bins <= 0 || c.times.empty() ||
+        c.length.upper() < MC_MIN_LENGTH) {
+        return false;
+    }
+    if (c.integrator != INTEGRATOR_RK4 && (c.integrator != INTEGRATOR_VERLET || c.angular)) {
+        std::cout << "the ensemble supports rk4 and verlet only, and rk4 only in angle space" << std::endl;
+        return false;
+    }
+    config = c;
+
+    outputSteps.clear();
+    for (size_t k = 0; k < c.times.size(); ++k) {
+        if (c.times[k] < 0.0) {
+            return false;
+        }
+        outputSteps.push_back((long long)(c.times[k]/c.dt + 0.5));
+    }
+    std::sort(outputSteps.begin(), outputSteps.end());
+
+    // automatic ranges hold every exact trajectory with its normal inputs
+    // within MC_RANGE_SIGMAS: the energy per unit mass is at most that of the
+    // largest length, angle and angular velocity, and |omega| peaks at the
+    // bottom, where omega^2 = omega0^2 + 2 g (1 - cos theta0) / L
+    double pi = glm::pi<double>();
+    double sigmas = MC_RANGE_SIGMAS;
+    double thetaMax = std::min(pi, std::max(std::fabs(c.theta0.lower(sigmas)), std::fabs(c.theta0.upper(sigmas))));
+    double omegaMax = std::max(std::fabs(c.omega0.lower(sigmas)), std::fabs(c.omega0.upper(sigmas)));
+    double lengthMin = std::max((double)MC_MIN_LENGTH, c.length.lower(sigmas));
+    double lengthMax = std::max((double)MC_MIN_LENGTH, c.length.upper(sigmas));
+    double drop = 2.0*c.gravity*(1.0 - std::cos(thetaMax));
+    double omegaBottom = std::sqrt(omegaMax*omegaMax + drop/lengthMin);
+    double e = 0.5*omegaMax*omegaMax*lengthMax*lengthMax + 0.5*drop*lengthMax;
+    double automatic[MC_QUANTITIES][2] = {
+        { -pi, pi },
+        { -1.1*omegaBottom, 1.1*omegaBottom },
+        { 0.0, 1.1*c.mass*e }
+    };
+    for (int q = 0; q < MC_QUANTITIES; ++q) {
+        if (config.range[q][0] >= config.range[q][1]) {
+            config.range[q][0] = automatic[q][0];
+            config.range[q][1] = automatic[q][1];
+        }
+        if (config.range[q][0] >= config.range[q][1]) {
+            // every member at rest
+            config.range[q][0] -= 1.0;
+            config.range[q][1] += 1.0;
+        }
+    }
+
+    int slots = getOutputCount()*MC_QUANTITIES;
+    stats.assign(slots, RunningStats());
+    histograms.resize(slots);
+    for (int s = 0; s < slots; ++s) {
+        int q = s % MC_QUANTITIES;
+        histograms[s].init(config.range[q][0], config.range[q][1], config.bins);
+    }
+    long long batchCount = (c.members + MC_BATCH_SIZE - 1)/MC_BATCH_SIZE;
+    batches.resize((size_t)std::min(batchCount, (long long)MC_ROUND_BATCHES));
+    for (size_t b = 0; b < batches.size(); ++b) {
+        batches[b].ensemble = new Ensemble();
+        batches[b].stats = stats;
+        batches[b].histograms = histograms;
+        batches[b].redraws = 0;
+    }
+    redraws = 0;
+
+    isInited = true;
+    return true;
+}
+
+void MonteCarloEnsemble::cleanup()
+{
+    if (!isInited) {
+        return;
+    }
+    for (size_t b = 0; b < batches.size(); ++b) {
+        delete batches[b].ensemble;
+    }
+    batches.clear();
+    stats.clear();
+    histograms.clear();
+    outputSteps.clear();
+
+    isInited = false;
+}
+
+void MonteCarloEnsemble::sampleMember(long long member, float &theta, float &omega, float &length, long long &rejected) const
+{
+    // each variable owns 128 draws of the member
+    uint64_t seed = config.seed;
+    theta = (float)config.theta0.sample(memberUniform(seed, member, 0), memberUniform(seed, member, 1));
+    omega = (float)config.omega0.sample(memberUniform(seed, member, 128), memberUniform(seed, member, 129));
+    length = 0.0f;
+    for (unsigned attempt = 0; attempt < 64 && length < MC_MIN_LENGTH; ++attempt) {
+        if (attempt > 0) {
+            rejected++;
+        }
+        length = (float)config.length.sample(memberUniform(seed, member, 256 + 2*attempt),
+                                             memberUniform(seed, member, 257 + 2*attempt));
+    }
+    length = std::max(length, MC_MIN_LENGTH);
+}
+
+void MonteCarloEnsemble::runBatch(Batch &batch, long long first, int n)
+{
+    Ensemble &ensemble = *batch.ensemble;
+    ensemble.init(n, config.pivot, config.gravity);
+    batch.redraws = 0;
+    for (int i = 0; i < n; ++i) {
+        float theta, omega, length;
+        sampleMember(first + i, theta, omega, length, batch.redraws);
+        ensemble.setPendulum(i, theta, omega, length, config.mass);
+    }
+    for (size_t s = 0; s < batch.stats.size(); ++s) {
+        batch.stats[s] = RunningStats();
+        batch.histograms[s].clear();
+    }
+
+    long long step = 0;
+    double g = config.gravity;
+    for (int k = 0; k < getOutputCount(); ++k) {
+        for (; step < outputSteps[k]; ++step) {
+            if (config.angular) {
+                ensemble.IntegrateAngleRK4(config.dt);
+            } else if (config.integrator == INTEGRATOR_RK4) {
+                ensemble.IntegrateRK4(config.dt);
+            } else {
+                ensemble.IntegrateVerlet(config.dt);
+            }
+        }
+        RunningStats *s = &batch.stats[k*MC_QUANTITIES];
+        Histogram *h = &batch.histograms[k*MC_QUANTITIES];
+        for (int i = 0; i < n; ++i) {
+            glm::vec3 r = ensemble.getPosition(i) - config.pivot;
+            glm::vec3 v = ensemble.getVelocity(i);
+            double m = ensemble.getMass(i);
+            double r2 = (double)r.x*r.x + (double)r.z*r.z;
+            double value[MC_QUANTITIES];
+            value[MC_THETA] = std::atan2((double)r.x, -(double)r.z);
+            value[MC_OMEGA] = ((double)r.x*v.z - (double)r.z*v.x)/r2;
+            value[MC_ENERGY] = 0.5*m*((double)v.x*v.x + (double)v.z*v.z) + m*g*((double)r.z + ensemble.getLength(i));
+            for (int q = 0; q < MC_QUANTITIES; ++q) {
+                s[q].add(value[q]);
+                h[q].add(value[q]);
+            }
+        }
+    }
+}
+
+void MonteCarloEnsemble::run(ThreadPool &pool)
+{
+    if (!isInited) {
+        std::cout << "please call init() before run()" << std::endl;
+        return;
+    }
+    long long members = config.members;
+    long long batchCount = (members + MC_BATCH_SIZE - 1)/MC_BATCH_SIZE;
+    for (long long first = 0; first < batchCount; first += MC_ROUND_BATCHES) {
+        long long round = std::min((long long)MC_ROUND_BATCHES, batchCount - first);
+        pool.parallelFor(round, 1, [&](long long begin, long long end){
+            for (long long b = begin; b < end; ++b) {
+                long long member = (first + b)*MC_BATCH_SIZE;
+                runBatch(batches[b], member, (int)std::min((long long)MC_BATCH_SIZE, members - member));
+            }
+        });
+        // always in batch order, whichever worker ran what
+        for (long long b = 0; b < round; ++b) {
+            for (size_t s = 0; s < stats.size(); ++s) {
+                stats[s].merge(batches[b].stats[s]);
+                histograms[s].merge(batches[b].histograms[s]);
+            }
+            redraws += batches[b].redraws;
+        }
+    }
+}
+
+void MonteCarloEnsemble::writeStats(std::ostream &out) const
+{
+    char line[256];
+    out << "time,quantity,count,mean,stddev,min,max\n";
+    for (int k = 0; k < getOutputCount(); ++k) {
+        for (int q = 0; q < MC_QUANTITIES; ++q) {
+            const RunningStats &s = getStats(k, q);
+            snprintf(line, sizeof(line), "%.6g,%s,%lld,%.9g,%.9g,%.9g,%.9g\n", getOutputTime(k),
+                     monteCarloQuantityName(q), s.count, s.mean, std::sqrt(s.variance()), s.min, s.max);
+            out << line;
+        }
+    }
+}
+
+void MonteCarloEnsemble::writeHistograms(std::ostream &out) const
+{
+    char line[256];
+    out << "time,quantity,bin,low,high,count\n";
+    for (int k = 0; k < getOutputCount(); ++k) {
+        for (int q = 0; q < MC_QUANTITIES; ++q) {
+            const Histogram &h = getHistogram(k, q);
+            // bin -1 is below the range, bin h.bins above it
+            for (int bin = -1; bin <= h.bins; ++bin) {
+                double low = bin < 0 ? -INFINITY : h.binLow(bin);
+                double high = bin < h.bins ? h.binLow(bin + 1) : INFINITY;
+                snprintf(line, sizeof(line), "%.6g,%s,%d,%.9g,%.9g,%lld\n", getOutputTime(k),
+                         monteCarloQuantityName(q), bin, low, high, h.counts[bin + 1]);
+                out << line;
+            }
+        }
+    }
+}
@@ -0,0 +1,165 @@
+#ifndef MONTECARLO_H
+#define MONTECARLO_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include <glm/glm.hpp>
+#include "physics.hpp"
+
+class ThreadPool;
+class Ensemble;
+
+// Welford's running mean and sum of squared deviations. merge() is Chan's
+// pairwise update, so partial statistics of disjoint sets combine into those
+// of their union; merging the same parts in the same order gives the same
+// bits every time.
+struct RunningStats
+{
+    long long count;
+    double mean, m2, min, max;
+
+    RunningStats() : count(0), mean(0.0), m2(0.0), min(0.0), max(0.0) {}
+    void add(double x);
+    void merge(const RunningStats &other);
+    // sample variance, 0 below two values
+    double variance() const { return count > 1 ? m2/(count - 1) : 0.0; }
+};
+
+// Equal-width bins over [lo, hi) plus one bin below and one above the range.
+// Counts are integers, so merging is exact in any order.
+struct Histogram
+{
+    double lo, hi;
+    int bins;
+    // counts[0] is below lo, counts[bins + 1] at or above hi
+    std::vector<long long> counts;
+
+    Histogram() : lo(0.0), hi(1.0), bins(0) {}
+    void init(double lo, double hi, int bins);
+    void clear();
+    void add(double x);
+    void merge(const Histogram &other);
+    double binLow(int bin) const { return lo + (hi - lo)*bin/bins; }
+};
+
+enum DistributionKind
+{
+    DIST_FIXED,     // always a
+    DIST_UNIFORM,   // uniform on [a, b)
+    DIST_NORMAL     // mean a, standard deviation b
+};
+
+struct Distribution
+{
+    DistributionKind kind;
+    double a, b;
+
+    // u1 and u2 uniform on (0, 1); DIST_NORMAL uses both (Box-Muller)
+    double sample(double u1, double u2) const;
+    // bounds of the values sample() returns; normal ones are cut at the
+    // given number of standard deviations, for sizing histograms
+    double lower(double sigmas = 6.0) const;
+    double upper(double sigmas = 6.0) const;
+};
+
+// "v", "uniform:a:b" or "normal:mean:sd", every number multiplied by scale
+bool parseDistribution(const char *text, Distribution &dist, double scale = 1.0);
+
+// the quantities tracked at each output time
+enum MonteCarloQuantity
+{
+    MC_THETA,    // angle from the vertical, radians in [-pi, pi]
+    MC_OMEGA,    // angular velocity, rad/s
+    MC_ENERGY,   // kinetic + potential above the member's lowest point, J
+    MC_QUANTITIES
+};
+
+const char *monteCarloQuantityName(int quantity);
+
+struct MonteCarloConfig
+{
+    long long members;
+    uint64_t seed;
+    Distribution theta0;     // radians
+    Distribution omega0;     // rad/s
+    Distribution length;     // m; draws below MC_MIN_LENGTH are redrawn
+    float mass;
+    float gravity;
+    glm::vec3 pivot;
+    float dt;
+    Integrator integrator;   // INTEGRATOR_RK4 or INTEGRATOR_VERLET
+    bool angular;            // Ensemble::IntegrateAngleRK4, rk4 only
+    std::vector<double> times;   // output times in seconds, 0 is the initial state
+    int bins;
+    // histogram range of each quantity; lo >= hi picks one from the
+    // distributions that holds every exact trajectory whose normally
+    // distributed inputs are within MC_RANGE_SIGMAS of their mean
+    double range[MC_QUANTITIES][2];
+
+    MonteCarloConfig();
+};
+
+#define MC_MIN_LENGTH 0.001f
+#define MC_RANGE_SIGMAS 3.0    // automatic histogram ranges; the tails go to the outer bins
+#define MC_BATCH_SIZE 1024     // members stepped together in one Ensemble
+#define MC_ROUND_BATCHES 64    // batches run in parallel between two merges
+
+// Propagates uncertain initial conditions through a large ensemble without
+// keeping any trajectory. Members are integrated in batches of MC_BATCH_SIZE
+// by the SIMD Ensemble kernels on a ThreadPool; each batch stops at the
+// output times and folds its members into its own RunningStats and
+// Histograms, then the batches of a round are merged into the totals in
+// batch order. Member i draws its initial conditions from a counter-based
+// generator keyed by the seed and i alone, and the batches and the merge
+// order are fixed by the member count, so the results are the same bits for
+// any number of threads. Memory is MC_ROUND_BATCHES ensembles plus
+// statistics per output time, independent of the members and the steps.
+class MonteCarloEnsemble
+{
+public:
+    MonteCarloEnsemble();
+    ~MonteCarloEnsemble();
+    MonteCarloEnsemble(const MonteCarloEnsemble&) = delete;
+    MonteCarloEnsemble& operator=(const MonteCarloEnsemble&) = delete;
+    // false if the configuration cannot run
+    bool init(const MonteCarloConfig &config);
+    void cleanup();
+    void run(ThreadPool &pool);
+
+    // output times in ascending order, rounded to whole steps
+    int getOutputCount() const { return (int)outputSteps.size(); }
+    double getOutputTime(int k) const { return outputSteps[k]*(double)config.dt; }
+    const RunningStats &getStats(int k, int quantity) const { return stats[k*MC_QUANTITIES + quantity]; }
+    const Histogram &getHistogram(int k, int quantity) const { return histograms[k*MC_QUANTITIES + quantity]; }
+    long long getSteps() const { return outputSteps.empty() ? 0 : outputSteps.back(); }
+    // length draws rejected for being below MC_MIN_LENGTH
+    long long getRedraws() const { return redraws; }
+
+    // one row per output time and quantity
+    void writeStats(std::ostream &out) const;
+    // one row per output time, quantity and bin, under- and overflow included
+    void writeHistograms(std::ostream &out) const;
+
+private:
+    struct Batch
+    {
+        Ensemble *ensemble;
+        std::vector<RunningStats> stats;
+        std::vector<Histogram> histograms;
+        long long redraws;
+    };
+
+    void runBatch(Batch &batch, long long first, int n);
+    void sampleMember(long long member, float &theta, float &omega, float &length, long long &redraws) const;
+
+    bool isInited;
+    MonteCarloConfig config;
+    std::vector<long long> outputSteps;
+    std::vector<RunningStats> stats;
+    std::vector<Histogram> histograms;
+    std::vector<Batch> batches;
+    long long redraws;
+};
+
+#endif // MONTECARLO_H
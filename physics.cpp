@@ -0,0 +1,298 @@
+#include "physics.hpp"
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include "logger.hpp"
+#include "fastmath.hpp"
+#include "container.hpp"
+
+// one ph.log line, formatted on the logger thread
+struct PhRecord
+{
+	glm::vec3 position;
+	glm::vec3 r;
+	float T;
+	glm::vec3 velocity;
+	glm::vec3 acceleration;
+	float theta;
+	glm::vec3 thetavel;
+};
+
+static void formatPhRecord(std::string &out, const PhRecord &rec){
+	char line[512];
+	snprintf(line,sizeof(line),
+		"Position: %g  %g  %g  r: %g  %g  %g   L: %g   T: %g   Velocity: %g  %g  %g   "
+		"Acceleration: %g  %g  %g  Theta:  %g  Thetavel:  %g  %g  %g\n",
+		rec.position.x,rec.position.y,rec.position.z,rec.r.x,rec.r.y,rec.r.z,glm::length(rec.r),rec.T,
+		rec.velocity.x,rec.velocity.y,rec.velocity.z,rec.acceleration.x,rec.acceleration.y,rec.acceleration.z,
+		rec.theta*180.0f/glm::pi<float>(),rec.thetavel.x,rec.thetavel.y,rec.thetavel.z);
+	out += line;
+}
+
+static AsyncLogger<PhRecord> ph_log;
+
+bool startPhysicsLog(unsigned sampling){
+	if (!ph_log.init(PH_LOG_FILE,formatPhRecord)){
+		return false;
+	}
+	ph_log.setSampling(sampling);
+	return true;
+}
+
+void stopPhysicsLog(){
+	ph_log.cleanup();
+}
+
+void setPhysicsLogEnabled(bool enabled){
+	ph_log.setEnabled(enabled);
+}
+
+unsigned long long getPhysicsLogDropped(){
+	return ph_log.getDropped();
+}
+
+#ifdef FAST_TRIG
+static bool fast_trig = true;
+#else
+static bool fast_trig = false;
+#endif
+
+void setFastTrig(bool enabled){
+	fast_trig = enabled;
+}
+
+bool getFastTrig(){
+	return fast_trig;
+}
+
+void updateAcceleration (Body &sphere, const PendulumParams &p){
+	glm::vec3 totalForce;
+	glm::vec3 r = glm::vec3(sphere.getPosition().x-p.puntofijo.x,sphere.getPosition().y-p.puntofijo.y,sphere.getPosition().z-p.puntofijo.z);
+	float theta, sintheta, costheta;
+	if (fast_trig){
+		theta = fastAtan((sphere.getPosition().x-p.puntofijo.x)/(p.puntofijo.z-sphere.getPosition().z));
+		fastSincos(theta,sintheta,costheta);
+	} else {
+		theta = glm::atan((sphere.getPosition().x-p.puntofijo.x)/(p.puntofijo.z-sphere.getPosition().z));
+		sintheta = glm::sin(theta);
+		costheta = glm::cos(theta);
+	}
+	//glm::vec3 thetavel = glm::cross(r,sphere.getVelocity());
+	glm::vec3 thetavel = glm::vec3(0.0f,glm::length(sphere.getVelocity())/p.L,0.0f);
+	float T = sphere.getMass()*p.gravity*costheta+sphere.getMass()*p.L*thetavel.y*thetavel.y;
+	float Ft = -sphere.getMass()*p.gravity*sintheta;
+	float Fn = -T + sphere.getMass()*p.gravity*costheta;
+
+	totalForce.x = Fn*sintheta+Ft*costheta;
+	totalForce.y = 0.0f;
+	totalForce.z = -Fn*costheta+Ft*sintheta;
+	sphere.setAcceleration(totalForce/(sphere.getMass()));
+
+#ifndef NO_LOG
+	if (ph_log.isEnabled()){
+		PhRecord rec;
+		rec.position = sphere.getPosition();
+		rec.r = r;
+		rec.T = T;
+		rec.velocity = sphere.getVelocity();
+		rec.acceleration = sphere.getAcceleration();
+		rec.theta = theta;
+		rec.thetavel = thetavel;
+		ph_log.push(rec);
+	}
+#endif
+}
+
+void IntegrateEuler(Body &sphere, float DT, const PendulumParams &p){
+		sphere.setVelocity(sphere.getAcceleration()*DT + sphere.getVelocity());
+		sphere.setPosition(sphere.getVelocity()*DT + sphere.getPosition());
+		updateAcceleration(sphere,p);
+}
+
+void IntegrateRK4(Body &bola, float DT, const PendulumParams &p)
+{
+	glm::vec3 Pos;
+	glm::vec3 Vel;
+
+	glm::vec3 Kv1,Kv2,Kv3,Kv4; //Son aceleraciones
+	glm::vec3 Kx1,Kx2,Kx3,Kx4; //Son velocidades
+	glm::vec3 xK2,xK3,xK4; //Son las posiciones estimadas para evaluar la aceleracion
+	Body etapa = bola; //estado intermedio donde se evalua la aceleracion
+
+	Kv1 = bola.getAcceleration();
+	Kx1 = bola.getVelocity();
+
+	xK2 = bola.getPosition() + Kx1*DT/2.0f;
+	Kx2 = bola.getVelocity() + Kv1 * DT/2.0f;
+	etapa.setPosition(xK2);
+	etapa.setVelocity(Kx2);
+	updateAcceleration(etapa,p);
+	Kv2 = etapa.getAcceleration();
+
+	xK3 = bola.getPosition() + Kx2*DT/2.0f;
+	Kx3 = bola.getVelocity() + Kv2 * DT/2.0f;
+	etapa.setPosition(xK3);
+	etapa.setVelocity(Kx3);
+	updateAcceleration(etapa,p);
+	Kv3 = etapa.getAcceleration();
+
+	xK4 = bola.getPosition() + Kx3*DT;
+	Kx4 = bola.getVelocity() + Kv3 * DT;
+	etapa.setPosition(xK4);
+	etapa.setVelocity(Kx4);
+	updateAcceleration(etapa,p);
+	Kv4 = etapa.getAcceleration();
+
+    Vel = bola.getVelocity() + (Kv1+Kv2*2.0f+Kv3*2.0f+Kv4)/6.0f*DT;
+    Pos = bola.getPosition() + (Kx1+Kx2*2.0f+Kx3*2.0f+Kx4)/6.0f*DT;
+
+	bola.setVelocity(Vel); // Update object's velocity
+	bola.setPosition(Pos); // Update object's position
+	updateAcceleration(bola,p); // Kv1 of the next step
+}
+
+void IntegrateVerlet (Body &sphere, float DT, const PendulumParams &p){
+        sphere.setPosition(sphere.getPosition() + sphere.getVelocity()*DT + 1.0f/2.0f*sphere.getAcceleration()*DT*DT);
+        glm::vec3 oldAcceleration=sphere.getAcceleration();
+        updateAcceleration(sphere,p);
+        sphere.setVelocity(sphere.getVelocity() + 1.0f/2.0f*(oldAcceleration*DT+sphere.getAcceleration()*DT));
+}
+
+void CheckBC(Body &sphere) {
+	defaultContainer().collide(sphere,R);
+}
+
+void SphereCollision (Body &sph1, Body &sph2){
+	if (glm::distance(sph1.getPosition(),sph2.getPosition()) <= 2*R){
+			glm::vec3 oldPosition1;
+			glm::vec3 oldPosition2;
+			glm::vec3 oldVelocity1;
+			glm::vec3 oldVelocity2;
+			glm::vec3 newPosition1;
+			glm::vec3 newPosition2;
+			glm::vec3 newVelocity1;
+			glm::vec3 newVelocity2;
+
+			oldPosition1 = sph1.getPosition();
+			oldPosition2 = sph2.getPosition();
+			oldVelocity1 = sph1.getVelocity();
+			oldVelocity2 = sph2.getVelocity();
+
+			/*newVelocity1 = oldVelocity1 + 
+			     glm::length(oldPosition2 - oldPosition1)*
+				 glm::dot(oldVelocity2,(oldPosition2 - oldPosition1))/
+				 glm::dot((oldPosition2 - oldPosition1),(oldPosition2 - oldPosition1)) -
+				 glm::length(oldPosition1 - oldPosition2)*
+				 glm::dot(oldVelocity1,(oldPosition1 - oldPosition2))/
+				 glm::dot((oldPosition1 - oldPosition2),(oldPosition1 - oldPosition2));
+
+			newVelocity2 = oldVelocity2 + 
+			     glm::length(oldPosition2 - oldPosition1)*
+				 glm::dot(oldVelocity1,(oldPosition2 - oldPosition1))/
+				 glm::dot((oldPosition2 - oldPosition1),(oldPosition2 - oldPosition1)) -
+				 glm::length(oldPosition1 - oldPosition2)*
+				 glm::dot(oldVelocity2,(oldPosition1 - oldPosition2))/
+				 glm::dot((oldPosition1 - oldPosition2),(oldPosition1 - oldPosition2));*/
+
+			glm::vec3 vecx = oldPosition1 - oldPosition2;
+			glm::normalize(vecx);
+			float x1 = glm::dot(vecx,oldVelocity1);
+			glm::vec3 vecv1x = vecx * x1;
+			glm::vec3 vecv1y = oldVelocity1 - vecv1x;
+			float m1 = sph1.getMass();
+
+			vecx = -vecx;
+			float x2 = glm::dot(vecx,oldVelocity2);
+			glm::vec3 vecv2x = vecx * x2;
+			glm::vec3 vecv2y = oldVelocity2 - vecv2x;
+			float m2 = sph2.getMass();
+
+			newVelocity1 = vecv1x*(m1-m2)/(m1+m2)+vecv2x*(2*m2)/(m1+m2) + vecv1y;
+			newVelocity2 = vecv1x*(2*m1)/(m1+m2)+vecv2x*(m2-m1)/(m1+m2) + vecv2y;
+
+
+			sph1.setVelocity(newVelocity1);
+			sph2.setVelocity(newVelocity2);
+		}
+}
+
+void initPendulum(Body &sphere, float theta, float mass, const PendulumParams &p){
+	sphere.setMass(mass);
+	sphere.setPosition(glm::vec3(p.puntofijo.x + p.L*glm::sin(theta),0.0f,p.puntofijo.z - p.L*glm::cos(theta)));
+	sphere.setVelocity(glm::vec3(0.0f,0.0f,0.0f));
+	updateAcceleration(sphere,p);
+}
+
+void Integrate(Body &sphere, float DT, Integrator integrator, const PendulumParams &p){
+	switch (integrator){
+		case INTEGRATOR_EULER:
+			IntegrateEuler(sphere,DT,p);
+			break;
+		case INTEGRATOR_RK4:
+			IntegrateRK4(sphere,DT,p);
+			break;
+		case INTEGRATOR_VERLET:
+			IntegrateVerlet(sphere,DT,p);
+			break;
+	}
+}
+
+float pendulumEnergy(const Body &sphere, const PendulumParams &p){
+	glm::vec3 v = sphere.getVelocity();
+	float height = sphere.getPosition().z - (p.puntofijo.z - p.L);
+	return 0.5f*sphere.getMass()*glm::dot(v,v) + sphere.getMass()*p.gravity*height;
+}
+
+float pendulumAngle(const Body &sphere, const PendulumParams &p){
+	glm::vec3 r = sphere.getPosition() - p.puntofijo;
+	return glm::atan(r.x,-r.z);
+}
+
+float pendulumAngularVelocity(const Body &sphere, const PendulumParams &p){
+	glm::vec3 r = sphere.getPosition() - p.puntofijo;
+	glm::vec3 v = sphere.getVelocity();
+	return (r.x*v.z - r.z*v.x)/glm::dot(r,r);
+}
+
+void setPendulumAngle(Body &sphere, float theta, float omega, const PendulumParams &p){
+	float s = glm::sin(theta);
+	float c = glm::cos(theta);
+	glm::vec3 radial = glm::vec3(s,0.0f,-c);
+	glm::vec3 tangent = glm::vec3(c,0.0f,s);
+	float alpha = -p.gravity/p.L*s;
+	sphere.setPosition(p.puntofijo + p.L*radial);
+	sphere.setVelocity(p.L*omega*tangent);
+	// tangential plus centripetal
+	sphere.setAcceleration(p.L*alpha*tangent - p.L*omega*omega*radial);
+
+#ifndef NO_LOG
+	if (ph_log.isEnabled()){
+		PhRecord rec;
+		rec.position = sphere.getPosition();
+		rec.r = sphere.getPosition() - p.puntofijo;
+		rec.T = sphere.getMass()*(p.gravity*c + p.L*omega*omega);
+		rec.velocity = sphere.getVelocity();
+		rec.acceleration = sphere.getAcceleration();
+		rec.theta = theta;
+		rec.thetavel = glm::vec3(0.0f,glm::abs(omega),0.0f);
+		ph_log.push(rec);
+	}
+#endif
+}
+
+const char *integratorName(Integrator integrator){
+	switch (integrator){
+		case INTEGRATOR_EULER: return "euler";
+		case INTEGRATOR_RK4: return "rk4";
+		case INTEGRATOR_VERLET: return "verlet";
+	}
+	return "unknown";
+}
+
+bool parseIntegrator(const char *name, Integrator &integrator){
+	if (strcmp(name,"euler") == 0) { integrator = INTEGRATOR_EULER; return true; }
+	if (strcmp(name,"rk4") == 0) { integrator = INTEGRATOR_RK4; return true; }
+	if (strcmp(name,"verlet") == 0) { integrator = INTEGRATOR_VERLET; return true; }
+	return false;
+}
@@ -0,0 +1,73 @@
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include <glm/glm.hpp>
+#include "body.hpp"
+
+#define PH_LOG_FILE "ph.log"
+
+const float gravity = 9.80665f;
+const float R = 0.5f;
+const glm::vec3 puntofijo = glm::vec3(0.0f,0.0f,4.0f);
+const float L = 2.0f;
+const float theta0 = glm::pi<float>()/4;
+
+// Parameters of the pendulum force model. The defaults are the constants
+// above; sweeps and ensembles pass their own.
+struct PendulumParams
+{
+    float gravity;
+    float L;
+    glm::vec3 puntofijo;
+};
+
+const PendulumParams defaultParams = { gravity, L, puntofijo };
+
+enum Integrator
+{
+    INTEGRATOR_EULER,
+    INTEGRATOR_RK4,
+    INTEGRATOR_VERLET
+};
+
+// ph.log is written by a background thread and is off until started. Only
+// one thread may call updateAcceleration while it is running.
+bool startPhysicsLog(unsigned sampling = 1);
+void stopPhysicsLog();
+void setPhysicsLogEnabled(bool enabled);
+// records lost because the writer fell behind; raise the sampling interval if non-zero
+unsigned long long getPhysicsLogDropped();
+
+// Run-time choice between libm and the polynomials of fastmath.hpp for the
+// trigonometry of the force model. Off by default; building with -DFAST_TRIG
+// turns it on.
+void setFastTrig(bool enabled);
+bool getFastTrig();
+
+void updateAcceleration(Body &sphere, const PendulumParams &p = defaultParams);
+void IntegrateEuler(Body &sphere, float DT, const PendulumParams &p = defaultParams);
+void IntegrateRK4(Body &bola, float DT, const PendulumParams &p = defaultParams);
+void IntegrateVerlet(Body &sphere, float DT, const PendulumParams &p = defaultParams);
+// keeps the sphere inside defaultContainer() (container.hpp)
+void CheckBC(Body &sphere);
+void SphereCollision(Body &sph1, Body &sph2);
+
+// places the body at rest on the rod at angle theta and evaluates its initial acceleration
+void initPendulum(Body &sphere, float theta = theta0, float mass = 1.0f, const PendulumParams &p = defaultParams);
+// advances the body one step with the selected integrator
+void Integrate(Body &sphere, float DT, Integrator integrator, const PendulumParams &p = defaultParams);
+// kinetic plus potential energy, measured from the lowest point of the swing
+float pendulumEnergy(const Body &sphere, const PendulumParams &p = defaultParams);
+// angle of the rod from the vertical, positive towards +x
+float pendulumAngle(const Body &sphere, const PendulumParams &p = defaultParams);
+// d(theta)/dt of a body moving on the pendulum's circle
+float pendulumAngularVelocity(const Body &sphere, const PendulumParams &p = defaultParams);
+// Cartesian state of a pendulum at angle theta turning at omega, exactly on
+// the circle of radius L. Used by the angle-space solver to render and log;
+// writes a ph.log record like updateAcceleration.
+void setPendulumAngle(Body &sphere, float theta, float omega, const PendulumParams &p = defaultParams);
+const char *integratorName(Integrator integrator);
+// returns false if name is not one of "euler", "rk4" or "verlet"
+bool parseIntegrator(const char *name, Integrator &integrator);
+
+#endif // PHYSICS_H
@@ -1,4 +1,5 @@
 #include "plane.hpp"
+#include "mesh.hpp"
 
 #include <vector>
 #include <iostream>
@@ -25,42 +26,10 @@ Plane::~Plane()
 
 void Plane::init(GLuint vertexPositionID, float z0)
 {
-    int i, j,k;
+    int k;
     std::vector<GLfloat> vertices;
     std::vector<GLuint> indices;
-    
-    for(i = -divsx; i <= divsx; ++i) {
-       
-       for(j = -divsy; j <= divsy; ++j) {
-           double x = j;
-           double y = i;
-           double z = z0;
-           vertices.push_back(x);
-           vertices.push_back(y);
-           vertices.push_back(z);
-           
-        }
-    }
-
-    for (int r=0; r< 2*divsx; r++)
-    {
-    //Set idx to point at first vertex of row r
-        int idx=r*(2*divsx+1);
-
-        for (int c=0; c< 2*divsy; c++)
-        {        
-          //Bottom triangle of the quad
-          indices.push_back(idx);
-          indices.push_back(idx+1);
-          indices.push_back(idx+2*divsx+1);
-          //Top triangle of the quad
-          indices.push_back(idx+1);
-          indices.push_back(idx+2*divsx+2);
-          indices.push_back(idx+2*divsx+1);
-          //Move one vertex to the right
-          idx++;
-        }
-    }
+    buildPlaneMesh(z0, divsx, divsy, vertices, indices);
 
     glGenVertexArrays(1, &plane_vao);
     glBindVertexArray(plane_vao);
@@ -0,0 +1,148 @@
+#include "profiler.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::reset()
+{
+    memset(counts, 0, sizeof(counts));
+    count = 0;
+    total = 0;
+    minValue = UINT64_MAX;
+    maxValue = 0;
+}
+
+int LatencyHistogram::bucketOf(uint64_t ns)
+{
+    if (ns < 2 * (uint64_t)SUB) {
+        return (int)ns;
+    }
+    int msb = 63;
+    while (!(ns >> msb)) {
+        msb--;
+    }
+    if (msb > MAX_BITS) {
+        return BUCKETS - 1;
+    }
+    int shift = msb - SUB_BITS;
+    return shift * SUB + (int)(ns >> shift);
+}
+
+uint64_t LatencyHistogram::bucketTop(int i)
+{
+    if (i < 2 * SUB) {
+        return i;
+    }
+    int shift = i / SUB - 1;
+    uint64_t mantissa = i - shift * SUB;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns)
+{
+    counts[bucketOf(ns)]++;
+    count++;
+    total += ns;
+    if (ns < minValue) {
+        minValue = ns;
+    }
+    if (ns > maxValue) {
+        maxValue = ns;
+    }
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    for (int i = 0; i < BUCKETS; ++i) {
+        counts[i] += other.counts[i];
+    }
+    count += other.count;
+    total += other.total;
+    if (other.minValue < minValue) {
+        minValue = other.minValue;
+    }
+    if (other.maxValue > maxValue) {
+        maxValue = other.maxValue;
+    }
+}
+
+uint64_t LatencyHistogram::percentile(double p) const
+{
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(p * count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            // the last bucket also holds everything beyond the range
+            uint64_t top = i == BUCKETS - 1 ? maxValue : bucketTop(i);
+            return top < maxValue ? top : maxValue;
+        }
+    }
+    return maxValue;
+}
+
+FrameProfiler::FrameProfiler()
+{
+    phaseCount = 0;
+}
+
+int FrameProfiler::addPhase(const char *name)
+{
+    if (phaseCount == MAX_PHASES) {
+        return -1;
+    }
+    names[phaseCount] = name;
+    histograms[phaseCount].reset();
+    return phaseCount++;
+}
+
+void FrameProfiler::record(int phase, uint64_t ns)
+{
+    if (phase >= 0 && phase < phaseCount) {
+        histograms[phase].record(ns);
+    }
+}
+
+void FrameProfiler::reset()
+{
+    for (int i = 0; i < phaseCount; ++i) {
+        histograms[i].reset();
+    }
+}
+
+void FrameProfiler::printSummary(std::ostream &out) const
+{
+    char line[160];
+    snprintf(line, sizeof(line), "%-16s %10s %10s %10s %10s %10s %10s\n",
+             "phase (us)", "samples", "mean", "p50", "p95", "p99", "max");
+    out << line;
+    for (int i = 0; i < phaseCount; ++i) {
+        const LatencyHistogram &h = histograms[i];
+        snprintf(line, sizeof(line), "%-16s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                 names[i], (unsigned long long)h.getCount(), h.getMean() / 1e3,
+                 h.percentile(0.50) / 1e3, h.percentile(0.95) / 1e3, h.percentile(0.99) / 1e3, h.getMax() / 1e3);
+        out << line;
+    }
+}
+
+bool FrameProfiler::dump(const char *path) const
+{
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+    printSummary(file);
+    return true;
+}
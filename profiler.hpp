@@ -0,0 +1,93 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <ostream>
+#include <cstdint>
+
+// Latency histogram with fixed memory and bounded relative error, in the
+// style of HdrHistogram: values below 2*SUB are counted exactly, above that
+// each power of two is split into SUB linear buckets, so any recorded value
+// is reported within 1/SUB (0.8%) of itself. Covers 1 ns to about 36 minutes.
+class LatencyHistogram
+{
+public:
+    static const int SUB_BITS = 7;
+    static const int SUB = 1 << SUB_BITS;
+    static const int MAX_BITS = 40;
+    static const int BUCKETS = SUB * (MAX_BITS - SUB_BITS + 2);
+
+    LatencyHistogram();
+    void reset();
+    void record(uint64_t ns);
+    // adds the counts of another histogram
+    void merge(const LatencyHistogram &other);
+
+    // smallest recorded value v such that a fraction p (0..1) of the samples are <= v,
+    // to the histogram's resolution
+    uint64_t percentile(double p) const;
+    uint64_t getMin() const { return count ? minValue : 0; }
+    uint64_t getMax() const { return maxValue; }
+    double getMean() const { return count ? (double)total / count : 0.0; }
+    uint64_t getCount() const { return count; }
+
+private:
+    static int bucketOf(uint64_t ns);
+    // highest value that falls in bucket i
+    static uint64_t bucketTop(int i);
+
+    uint64_t counts[BUCKETS];
+    uint64_t count;
+    uint64_t total;
+    uint64_t minValue, maxValue;
+};
+
+// Named phases of a frame, each with its own histogram. Phases are added
+// once at startup; timing a phase is two clock reads and one bucket increment,
+// with no allocation or I/O, so it does not distort what it measures.
+class FrameProfiler
+{
+public:
+    static const int MAX_PHASES = 16;
+
+    FrameProfiler();
+    // returns the phase id, or -1 if the table is full
+    int addPhase(const char *name);
+    void record(int phase, uint64_t ns);
+    void reset();
+    const LatencyHistogram &getHistogram(int phase) const { return histograms[phase]; }
+    int getPhaseCount() const { return phaseCount; }
+
+    // one line per phase: samples, mean, p50, p95, p99 and max in microseconds
+    void printSummary(std::ostream &out) const;
+    bool dump(const char *path) const;
+
+private:
+    const char *names[MAX_PHASES];
+    LatencyHistogram histograms[MAX_PHASES];
+    int phaseCount;
+};
+
+// times the enclosing scope into one phase; compiled out with -DNO_PROFILE
+class ProfileScope
+{
+public:
+#ifndef NO_PROFILE
+    ProfileScope(FrameProfiler &profiler, int phase)
+        : profiler(profiler), phase(phase), start(std::chrono::steady_clock::now()) {}
+    ~ProfileScope()
+    {
+        std::chrono::steady_clock::duration d = std::chrono::steady_clock::now() - start;
+        profiler.record(phase, std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    }
+
+private:
+    FrameProfiler &profiler;
+    int phase;
+    std::chrono::steady_clock::time_point start;
+#else
+    ProfileScope(FrameProfiler &, int) {}
+#endif
+};
+
+#endif // PROFILER_H
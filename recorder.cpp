@@ -0,0 +1,358 @@
+#include "recorder.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#define PIPE_MODE "wb"
+#else
+#define PIPE_MODE "w"
+#endif
+
+FrameRecorder::FrameRecorder()
+{
+    isInited = false;
+    width = 0;
+    height = 0;
+    samples = 0;
+    ms_fbo = ms_color = ms_depth = 0;
+    resolve_fbo = resolve_color = resolve_depth = 0;
+    captured = 0;
+    written = 0;
+    output = OUTPUT_NONE;
+    out = NULL;
+    failed = false;
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    close();
+}
+
+static GLuint makeRenderbuffer(GLenum format, int samples, int width, int height)
+{
+    GLuint rb;
+    glGenRenderbuffers(1, &rb);
+    glBindRenderbuffer(GL_RENDERBUFFER, rb);
+    if (samples > 0) {
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, format, width, height);
+    } else {
+        glRenderbufferStorage(GL_RENDERBUFFER, format, width, height);
+    }
+    return rb;
+}
+
+bool FrameRecorder::init(int w, int h, int s, int ring)
+{
+    if (isInited) {
+        cleanup();
+    }
+    width = w;
+    height = h;
+    samples = s;
+    isInited = true;
+
+    // the multisampled target is drawn into and resolved into a single-sampled
+    // one for reading; without samples the single-sampled one is drawn into
+    if (samples > 0) {
+        glGenFramebuffers(1, &ms_fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, ms_fbo);
+        ms_color = makeRenderbuffer(GL_RGBA8, samples, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ms_color);
+        ms_depth = makeRenderbuffer(GL_DEPTH_COMPONENT24, samples, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, ms_depth);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "multisampled offscreen framebuffer is incomplete" << std::endl;
+            cleanup();
+            return false;
+        }
+    }
+    glGenFramebuffers(1, &resolve_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, resolve_fbo);
+    resolve_color = makeRenderbuffer(GL_RGBA8, 0, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolve_color);
+    if (samples == 0) {
+        resolve_depth = makeRenderbuffer(GL_DEPTH_COMPONENT24, 0, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, resolve_depth);
+    }
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "offscreen framebuffer is incomplete" << std::endl;
+        cleanup();
+        return false;
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // RGBA is the format drivers read back without converting
+    pbos.assign(ring, 0);
+    fences.assign(ring, (GLsync)0);
+    glGenBuffers(ring, &pbos[0]);
+    for (int i = 0; i < ring; ++i) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    rgb.resize((size_t)width * height * 3);
+    captured = 0;
+    written = 0;
+    failed = false;
+    return true;
+}
+
+void FrameRecorder::cleanup()
+{
+    if (!isInited) {
+        return;
+    }
+    for (size_t i = 0; i < fences.size(); ++i) {
+        if (fences[i]) {
+            glDeleteSync(fences[i]);
+        }
+    }
+    if (!pbos.empty()) {
+        glDeleteBuffers((GLsizei)pbos.size(), &pbos[0]);
+    }
+    GLuint renderbuffers[4] = { ms_color, ms_depth, resolve_color, resolve_depth };
+    glDeleteRenderbuffers(4, renderbuffers);
+    GLuint framebuffers[2] = { ms_fbo, resolve_fbo };
+    glDeleteFramebuffers(2, framebuffers);
+
+    isInited = false;
+    ms_fbo = ms_color = ms_depth = 0;
+    resolve_fbo = resolve_color = resolve_depth = 0;
+    pbos.clear();
+    fences.clear();
+}
+
+bool FrameRecorder::openFile(const char *path)
+{
+    close();
+    if (strchr(path, '%')) {
+        pattern = path;
+        output = OUTPUT_PNG;
+        return true;
+    }
+    out = fopen(path, "wb");
+    if (!out) {
+        return false;
+    }
+    output = OUTPUT_RAW;
+    return true;
+}
+
+bool FrameRecorder::openPipe(const char *command)
+{
+    close();
+    out = popen(command, PIPE_MODE);
+    if (!out) {
+        return false;
+    }
+    output = OUTPUT_PIPE;
+    return true;
+}
+
+void FrameRecorder::close()
+{
+    if (output == OUTPUT_RAW) {
+        fclose(out);
+    } else if (output == OUTPUT_PIPE) {
+        pclose(out);
+    }
+    out = NULL;
+    output = OUTPUT_NONE;
+}
+
+void FrameRecorder::bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, samples > 0 ? ms_fbo : resolve_fbo);
+    glViewport(0, 0, width, height);
+}
+
+bool FrameRecorder::capture()
+{
+    if (!isInited) {
+        std::cout << "please call init() before capture()" << std::endl;
+        return false;
+    }
+    if (samples > 0) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, ms_fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolve_fbo);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, resolve_fbo);
+
+    // the slot about to be reused holds the oldest frame in flight
+    int slot = (int)(captured % (long long)pbos.size());
+    if (fences[slot] && !writeSlot(slot)) {
+        failed = true;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    captured++;
+    return !failed;
+}
+
+bool FrameRecorder::finish()
+{
+    const long long ring = (long long)pbos.size();
+    for (long long k = std::max(0LL, captured - ring); k < captured; ++k) {
+        int slot = (int)(k % ring);
+        if (fences[slot] && !writeSlot(slot)) {
+            failed = true;
+        }
+    }
+    return !failed;
+}
+
+bool FrameRecorder::writeSlot(int slot)
+{
+    while (glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED) {
+    }
+    glDeleteSync(fences[slot]);
+    fences[slot] = 0;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+    const unsigned char *pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                                                        (GLsizeiptr)width * height * 4, GL_MAP_READ_BIT);
+    if (!pixels) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return false;
+    }
+    // GL rows start at the bottom
+    for (int y = 0; y < height; ++y) {
+        const unsigned char *src = pixels + (size_t)(height - 1 - y) * width * 4;
+        unsigned char *dst = &rgb[(size_t)y * width * 3];
+        for (int x = 0; x < width; ++x) {
+            dst[3*x] = src[4*x];
+            dst[3*x + 1] = src[4*x + 1];
+            dst[3*x + 2] = src[4*x + 2];
+        }
+    }
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return writeRgb(&rgb[0]);
+}
+
+bool FrameRecorder::writeRgb(const unsigned char *image)
+{
+    bool ok = false;
+    if (output == OUTPUT_RAW || output == OUTPUT_PIPE) {
+        size_t size = (size_t)width * height * 3;
+        ok = fwrite(image, 1, size, out) == size;
+    } else if (output == OUTPUT_PNG) {
+        char name[4096];
+        snprintf(name, sizeof(name), pattern.c_str(), (int)written);
+        FILE *f = fopen(name, "wb");
+        if (f) {
+            ok = writePng(f, width, height, image);
+            ok = fclose(f) == 0 && ok;
+        }
+    }
+    if (ok) {
+        written++;
+    }
+    return ok;
+}
+
+static unsigned long crc32(unsigned long crc, const unsigned char *data, size_t n)
+{
+    static unsigned long table[256];
+    static bool tableReady = false;
+    if (!tableReady) {
+        for (unsigned long i = 0; i < 256; ++i) {
+            unsigned long c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320ul ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+    crc ^= 0xfffffffful;
+    for (size_t i = 0; i < n; ++i) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xfffffffful;
+}
+
+static void putBigEndian(std::vector<unsigned char> &v, unsigned long x)
+{
+    v.push_back((x >> 24) & 0xff);
+    v.push_back((x >> 16) & 0xff);
+    v.push_back((x >> 8) & 0xff);
+    v.push_back(x & 0xff);
+}
+
+static void putChunk(std::vector<unsigned char> &png, const char *type, const std::vector<unsigned char> &data)
+{
+    putBigEndian(png, data.size());
+    size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+    putBigEndian(png, crc32(0, &png[start], png.size() - start));
+}
+
+// The image data is a zlib stream of stored (uncompressed) deflate blocks:
+// no compressor is needed, at the price of files as large as the raw frames.
+// Pipe to an encoder for compact output.
+bool writePng(FILE *f, int width, int height, const unsigned char *rgb)
+{
+    static const unsigned char signature[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+    std::vector<unsigned char> png(signature, signature + 8);
+
+    std::vector<unsigned char> header;
+    putBigEndian(header, width);
+    putBigEndian(header, height);
+    header.push_back(8);    // bits per channel
+    header.push_back(2);    // RGB
+    header.push_back(0);    // deflate
+    header.push_back(0);    // adaptive filtering
+    header.push_back(0);    // not interlaced
+    putChunk(png, "IHDR", header);
+
+    // every row starts with its filter type, 0 for none
+    const size_t stride = (size_t)width * 3;
+    std::vector<unsigned char> raw;
+    raw.reserve((stride + 1) * height);
+    for (int y = 0; y < height; ++y) {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgb + y * stride, rgb + (y + 1) * stride);
+    }
+
+    std::vector<unsigned char> zlib;
+    zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    size_t pos = 0;
+    do {
+        size_t n = std::min(raw.size() - pos, (size_t)65535);
+        zlib.push_back(pos + n == raw.size() ? 1 : 0);
+        zlib.push_back(n & 0xff);
+        zlib.push_back(n >> 8);
+        zlib.push_back(~n & 0xff);
+        zlib.push_back((~n >> 8) & 0xff);
+        zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + n);
+        pos += n;
+    } while (pos < raw.size());
+    // Adler-32; 5552 bytes is the most that can be summed before b overflows
+    unsigned long a = 1, b = 0;
+    for (size_t i = 0; i < raw.size(); ) {
+        size_t end = std::min(raw.size(), i + 5552);
+        for (; i < end; ++i) {
+            a += raw[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    putBigEndian(zlib, (b << 16) | a);
+    putChunk(png, "IDAT", zlib);
+    putChunk(png, "IEND", std::vector<unsigned char>());
+
+    return fwrite(&png[0], 1, png.size(), f) == png.size();
+}
@@ -0,0 +1,64 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <GL/glew.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Renders frames into an offscreen framebuffer and streams them out without
+// stalling the pipeline. capture() starts an asynchronous glReadPixels into
+// the next of a ring of pixel buffer objects; the buffer it reuses holds the
+// frame captured a full ring earlier, which is mapped and written out first,
+// long after its transfer has finished. Frames are written top row first as
+// 8-bit RGB: to a raw file, as numbered PNG files, or to the stdin of an
+// encoder. Nothing here needs a visible window, so it runs the same on a
+// hidden window or a headless EGL/OSMesa context.
+class FrameRecorder
+{
+public:
+    FrameRecorder();
+    ~FrameRecorder();
+    // samples > 0 draws multisampled and resolves before reading back
+    bool init(int width, int height, int samples = 4, int ring = 3);
+    void cleanup();
+    // a path containing '%' is a printf pattern for a PNG sequence,
+    // e.g. frames/%05d.png; anything else gets raw RGB frames back to back
+    bool openFile(const char *path);
+    // raw RGB frames to the stdin of command, e.g. an ffmpeg rawvideo input
+    bool openPipe(const char *command);
+    void close();
+    // makes the offscreen framebuffer the draw target
+    void bind();
+    // reads back the frame just drawn; false once writing has failed
+    bool capture();
+    // writes the frames still in the ring
+    bool finish();
+    long long getFrames() const { return written; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    bool writeSlot(int slot);
+    bool writeRgb(const unsigned char *rgb);
+
+    enum Output { OUTPUT_NONE, OUTPUT_RAW, OUTPUT_PNG, OUTPUT_PIPE };
+
+    bool isInited;
+    int width, height, samples;
+    GLuint ms_fbo, ms_color, ms_depth;
+    GLuint resolve_fbo, resolve_color, resolve_depth;
+    std::vector<GLuint> pbos;
+    std::vector<GLsync> fences;
+    long long captured, written;
+    Output output;
+    FILE *out;
+    std::string pattern;
+    std::vector<unsigned char> rgb;
+    bool failed;
+};
+
+// one 8-bit RGB image, top row first, as an uncompressed PNG
+bool writePng(FILE *f, int width, int height, const unsigned char *rgb);
+
+#endif // RECORDER_H
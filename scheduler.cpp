@@ -0,0 +1,38 @@
+#include "scheduler.hpp"
+
+FixedStepScheduler::FixedStepScheduler()
+{
+    init(1.0f/120.0f, 1, 8);
+}
+
+void FixedStepScheduler::init(float dt, int sub, int max)
+{
+    stepDt = dt;
+    substeps = sub > 0 ? sub : 1;
+    maxSteps = max > 0 ? max : 1;
+    accumulator = 0.0;
+    steps = 0;
+    droppedSteps = 0;
+}
+
+void FixedStepScheduler::restore(long long n)
+{
+    accumulator = 0.0;
+    steps = n;
+}
+
+int FixedStepScheduler::advance(float frameTime)
+{
+    if (frameTime > 0.0f) {
+        accumulator += frameTime;
+    }
+    int n = (int)(accumulator / stepDt);
+    if (n > maxSteps) {
+        droppedSteps += n - maxSteps;
+        accumulator -= (double)(n - maxSteps) * stepDt;
+        n = maxSteps;
+    }
+    accumulator -= (double)n * stepDt;
+    steps += n;
+    return n;
+}
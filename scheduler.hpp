@@ -0,0 +1,40 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+// Turns variable frame times into a whole number of fixed physics steps.
+// Frame time goes into an accumulator; each step consumes stepDt of it. At
+// most maxSteps steps run per frame, older backlog is dropped instead of
+// making the next frame slower still. Each step is integrated as substeps
+// smaller steps of stepDt/substeps.
+class FixedStepScheduler
+{
+public:
+    FixedStepScheduler();
+    void init(float stepDt, int substeps, int maxSteps);
+
+    // adds one frame's time and returns how many fixed steps to run now
+    int advance(float frameTime);
+    // continues from a checkpoint taken after the given number of steps,
+    // with an empty accumulator
+    void restore(long long steps);
+
+    float getStepDt() const { return stepDt; }
+    float getSubstepDt() const { return stepDt / substeps; }
+    int getSubsteps() const { return substeps; }
+    // fraction of a step left in the accumulator, for interpolating the
+    // rendered state between the last two physics states
+    float getAlpha() const { return (float)(accumulator / stepDt); }
+    double getSimTime() const { return steps * (double)stepDt; }
+    long long getSteps() const { return steps; }
+    long long getDroppedSteps() const { return droppedSteps; }
+
+private:
+    float stepDt;
+    int substeps;
+    int maxSteps;
+    double accumulator;
+    long long steps;
+    long long droppedSteps;
+};
+
+#endif // SCHEDULER_H
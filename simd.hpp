@@ -0,0 +1,114 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// Thin wrapper over the widest float vector the build targets (AVX2, SSE2 or
+// plain scalar), so the batched kernels are written once. Loads and stores
+// expect pointers aligned to SIMD_ALIGN.
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_NAME "avx2"
+#define SIMD_WIDTH 8
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_NAME "sse2"
+#define SIMD_WIDTH 4
+#else
+#include <cmath>
+#define SIMD_NAME "scalar"
+#define SIMD_WIDTH 1
+#endif
+
+#define SIMD_ALIGN 64
+
+#if defined(__AVX2__)
+
+struct vfloat { __m256 v; };
+struct vmask { __m256 v; };
+
+inline vfloat vset(float a) { vfloat r = { _mm256_set1_ps(a) }; return r; }
+inline vfloat vload(const float *p) { vfloat r = { _mm256_load_ps(p) }; return r; }
+inline void vstore(float *p, vfloat a) { _mm256_store_ps(p, a.v); }
+inline vfloat operator+(vfloat a, vfloat b) { vfloat r = { _mm256_add_ps(a.v, b.v) }; return r; }
+inline vfloat operator-(vfloat a, vfloat b) { vfloat r = { _mm256_sub_ps(a.v, b.v) }; return r; }
+inline vfloat operator*(vfloat a, vfloat b) { vfloat r = { _mm256_mul_ps(a.v, b.v) }; return r; }
+inline vfloat operator/(vfloat a, vfloat b) { vfloat r = { _mm256_div_ps(a.v, b.v) }; return r; }
+inline vfloat vsqrt(vfloat a) { vfloat r = { _mm256_sqrt_ps(a.v) }; return r; }
+inline vfloat vmin(vfloat a, vfloat b) { vfloat r = { _mm256_min_ps(a.v, b.v) }; return r; }
+inline vfloat vmax(vfloat a, vfloat b) { vfloat r = { _mm256_max_ps(a.v, b.v) }; return r; }
+inline vfloat vfloor(vfloat a) { vfloat r = { _mm256_floor_ps(a.v) }; return r; }
+inline vfloat vabs(vfloat a) { vfloat r = { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v) }; return r; }
+#if defined(__FMA__)
+inline vfloat vfmadd(vfloat a, vfloat b, vfloat c) { vfloat r = { _mm256_fmadd_ps(a.v, b.v, c.v) }; return r; }
+#else
+inline vfloat vfmadd(vfloat a, vfloat b, vfloat c) { return a*b + c; }
+#endif
+inline vmask operator<(vfloat a, vfloat b) { vmask r = { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; return r; }
+inline vmask operator>(vfloat a, vfloat b) { vmask r = { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; return r; }
+inline vmask operator&(vmask a, vmask b) { vmask r = { _mm256_and_ps(a.v, b.v) }; return r; }
+inline vmask operator|(vmask a, vmask b) { vmask r = { _mm256_or_ps(a.v, b.v) }; return r; }
+// picks a where m is set, b elsewhere
+inline vfloat vselect(vmask m, vfloat a, vfloat b) { vfloat r = { _mm256_blendv_ps(b.v, a.v, m.v) }; return r; }
+inline bool vany(vmask m) { return _mm256_movemask_ps(m.v) != 0; }
+
+#elif defined(__SSE2__)
+
+struct vfloat { __m128 v; };
+struct vmask { __m128 v; };
+
+inline vfloat vset(float a) { vfloat r = { _mm_set1_ps(a) }; return r; }
+inline vfloat vload(const float *p) { vfloat r = { _mm_load_ps(p) }; return r; }
+inline void vstore(float *p, vfloat a) { _mm_store_ps(p, a.v); }
+inline vfloat operator+(vfloat a, vfloat b) { vfloat r = { _mm_add_ps(a.v, b.v) }; return r; }
+inline vfloat operator-(vfloat a, vfloat b) { vfloat r = { _mm_sub_ps(a.v, b.v) }; return r; }
+inline vfloat operator*(vfloat a, vfloat b) { vfloat r = { _mm_mul_ps(a.v, b.v) }; return r; }
+inline vfloat operator/(vfloat a, vfloat b) { vfloat r = { _mm_div_ps(a.v, b.v) }; return r; }
+inline vfloat vsqrt(vfloat a) { vfloat r = { _mm_sqrt_ps(a.v) }; return r; }
+inline vfloat vmin(vfloat a, vfloat b) { vfloat r = { _mm_min_ps(a.v, b.v) }; return r; }
+inline vfloat vmax(vfloat a, vfloat b) { vfloat r = { _mm_max_ps(a.v, b.v) }; return r; }
+// SSE2 has no floor: truncate, then step down where that rounded up (valid below 2^31)
+inline vfloat vfloor(vfloat a)
+{
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+    vfloat r = { _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f))) };
+    return r;
+}
+inline vfloat vabs(vfloat a) { vfloat r = { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) }; return r; }
+inline vfloat vfmadd(vfloat a, vfloat b, vfloat c) { return a*b + c; }
+inline vmask operator<(vfloat a, vfloat b) { vmask r = { _mm_cmplt_ps(a.v, b.v) }; return r; }
+inline vmask operator>(vfloat a, vfloat b) { vmask r = { _mm_cmpgt_ps(a.v, b.v) }; return r; }
+inline vmask operator&(vmask a, vmask b) { vmask r = { _mm_and_ps(a.v, b.v) }; return r; }
+inline vmask operator|(vmask a, vmask b) { vmask r = { _mm_or_ps(a.v, b.v) }; return r; }
+inline vfloat vselect(vmask m, vfloat a, vfloat b) { vfloat r = { _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)) }; return r; }
+inline bool vany(vmask m) { return _mm_movemask_ps(m.v) != 0; }
+
+#else
+
+struct vfloat { float v; };
+struct vmask { bool v; };
+
+inline vfloat vset(float a) { vfloat r = { a }; return r; }
+inline vfloat vload(const float *p) { vfloat r = { *p }; return r; }
+inline void vstore(float *p, vfloat a) { *p = a.v; }
+inline vfloat operator+(vfloat a, vfloat b) { vfloat r = { a.v + b.v }; return r; }
+inline vfloat operator-(vfloat a, vfloat b) { vfloat r = { a.v - b.v }; return r; }
+inline vfloat operator*(vfloat a, vfloat b) { vfloat r = { a.v * b.v }; return r; }
+inline vfloat operator/(vfloat a, vfloat b) { vfloat r = { a.v / b.v }; return r; }
+inline vfloat vsqrt(vfloat a) { vfloat r = { std::sqrt(a.v) }; return r; }
+inline vfloat vmin(vfloat a, vfloat b) { vfloat r = { a.v < b.v ? a.v : b.v }; return r; }
+inline vfloat vmax(vfloat a, vfloat b) { vfloat r = { a.v > b.v ? a.v : b.v }; return r; }
+inline vfloat vfloor(vfloat a) { vfloat r = { std::floor(a.v) }; return r; }
+inline vfloat vabs(vfloat a) { vfloat r = { std::fabs(a.v) }; return r; }
+inline vfloat vfmadd(vfloat a, vfloat b, vfloat c) { return a*b + c; }
+inline vmask operator<(vfloat a, vfloat b) { vmask r = { a.v < b.v }; return r; }
+inline vmask operator>(vfloat a, vfloat b) { vmask r = { a.v > b.v }; return r; }
+inline vmask operator&(vmask a, vmask b) { vmask r = { a.v && b.v }; return r; }
+inline vmask operator|(vmask a, vmask b) { vmask r = { a.v || b.v }; return r; }
+inline vfloat vselect(vmask m, vfloat a, vfloat b) { return m.v ? a : b; }
+inline bool vany(vmask m) { return m.v; }
+
+#endif
+
+inline vfloat operator-(vfloat a) { return vset(0.0f) - a; }
+
+#endif // SIMD_H
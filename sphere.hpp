@@ -3,37 +3,31 @@
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include "body.hpp"
+#include "meshcache.hpp"
 
-class Sphere
+class Sphere : public Body
 {
 public:
     Sphere();
     ~Sphere();
+    // meshes come from sharedMeshCache(), so spheres of the same radius
+    // share their GPU buffers
     void init(GLuint vertexPositionID, float radius);
     void cleanup();
     void draw();
-    glm::vec3 getPosition() const { return position; }
-	glm::vec3 getVelocity() const { return velocity; }
-	glm::vec3 getAcceleration() const { return acceleration; }
-
-	void setPosition(const glm::vec3& a) { position = a; }
-	void setVelocity(const glm::vec3& a) { velocity = a; }
-	void setAcceleration(const glm::vec3& a) { acceleration = a; }
-
-	float getMass() const { return mass; }
-	void setMass(const float a) { mass = a; }
+    // draws the same mesh count times; the vertex shader tells the copies
+    // apart by gl_InstanceID
+    void drawInstanced(int count);
+    // 0 is the finest level, see pickSphereLod()
+    void setLod(int level);
+    int getLod() const;
 
 private:
-    int sectorCount, stackCount;
     bool isInited;
-    GLuint sphere_vao, sphere_vboVertex, sphere_vboIndex;
-    int numsToDraw;
-    glm::vec3 position;
-    glm::vec3 velocity;
-    glm::vec3 acceleration;
-    float mass;
-    
+    const GpuMesh *lods[SPHERE_LOD_COUNT];
+    int lod;
 
 };
 
-#endif // SPHERE_H
\ No newline at end of file
+#endif // SPHERE_H
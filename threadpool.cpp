@@ -0,0 +1,123 @@
+#include "threadpool.hpp"
+
+ThreadPool::ThreadPool()
+{
+    generation = 0;
+    pending.store(0);
+    stopping = false;
+}
+
+ThreadPool::~ThreadPool()
+{
+    cleanup();
+}
+
+void ThreadPool::init(int threads)
+{
+    cleanup();
+    if (threads <= 0) {
+        threads = (int)std::thread::hardware_concurrency();
+        if (threads <= 0) {
+            threads = 1;
+        }
+    }
+    stopping = false;
+    for (int i = 0; i < threads; ++i) {
+        queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    }
+    for (int i = 0; i < threads; ++i) {
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+    }
+}
+
+void ThreadPool::cleanup()
+{
+    {
+        std::lock_guard<std::mutex> guard(jobLock);
+        stopping = true;
+    }
+    jobReady.notify_all();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    workers.clear();
+    queues.clear();
+}
+
+void ThreadPool::parallelFor(long long n, long long grain, const RangeFn &fn)
+{
+    if (n <= 0) {
+        return;
+    }
+    if (grain <= 0) {
+        grain = 1;
+    }
+    if (workers.empty()) {
+        fn(0, n);
+        return;
+    }
+
+    long long chunkCount = (n + grain - 1) / grain;
+    long long perWorker = (chunkCount + workers.size() - 1) / workers.size();
+    std::unique_lock<std::mutex> guard(jobLock);
+    pending.store(chunkCount);
+    for (long long c = 0; c < chunkCount; ++c) {
+        Chunk chunk = { c*grain, c*grain + grain < n ? c*grain + grain : n, &fn };
+        WorkQueue &q = *queues[c / perWorker];
+        std::lock_guard<std::mutex> qguard(q.lock);
+        q.chunks.push_back(chunk);
+    }
+    ++generation;
+    jobReady.notify_all();
+    jobDone.wait(guard, [this] { return pending.load() == 0; });
+}
+
+bool ThreadPool::popLocal(int id, Chunk &chunk)
+{
+    WorkQueue &q = *queues[id];
+    std::lock_guard<std::mutex> guard(q.lock);
+    if (q.chunks.empty()) {
+        return false;
+    }
+    chunk = q.chunks.back();
+    q.chunks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(int id, Chunk &chunk)
+{
+    int n = (int)queues.size();
+    for (int k = 1; k < n; ++k) {
+        WorkQueue &q = *queues[(id + k) % n];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (!q.chunks.empty()) {
+            chunk = q.chunks.front();
+            q.chunks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(int id)
+{
+    unsigned long long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(jobLock);
+            jobReady.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        Chunk chunk;
+        while (popLocal(id, chunk) || steal(id, chunk)) {
+            (*chunk.fn)(chunk.begin, chunk.end);
+            if (pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> guard(jobLock);
+                jobDone.notify_all();
+            }
+        }
+    }
+}
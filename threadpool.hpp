@@ -0,0 +1,62 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running parallelFor() jobs. The index range is
+// cut into chunks and dealt out in contiguous blocks, one deque per worker.
+// A worker takes chunks from the back of its own deque and, once that is
+// empty, steals from the front of the others, so uneven chunk costs still
+// keep every core busy.
+class ThreadPool
+{
+public:
+    typedef std::function<void(long long begin, long long end)> RangeFn;
+
+    ThreadPool();
+    ~ThreadPool();
+    // threads <= 0 uses one worker per hardware thread
+    void init(int threads);
+    void cleanup();
+    int size() const { return (int)workers.size(); }
+
+    // calls fn on chunks of at most grain indices covering [0, n) and
+    // returns when all of them are done. One job at a time.
+    void parallelFor(long long n, long long grain, const RangeFn &fn);
+
+private:
+    // chunks carry their job so a worker still draining one job can never
+    // run the next job's chunks with the wrong function
+    struct Chunk
+    {
+        long long begin, end;
+        const RangeFn *fn;
+    };
+    struct WorkQueue
+    {
+        std::mutex lock;
+        std::deque<Chunk> chunks;
+    };
+
+    void workerLoop(int id);
+    bool popLocal(int id, Chunk &chunk);
+    bool steal(int id, Chunk &chunk);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkQueue> > queues;
+    std::mutex jobLock;
+    std::condition_variable jobReady;
+    std::condition_variable jobDone;
+    unsigned long long generation;
+    std::atomic<long long> pending;
+    bool stopping;
+};
+
+#endif // THREADPOOL_H
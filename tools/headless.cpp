@@ -0,0 +1,563 @@
+// Runs the pendulum physics without a window or GL context, as fast as the
+// CPU allows, and reports the achieved steps per second.
+//
+// usage: headless [--dt seconds] [--steps n] [--integrator euler|rk4|verlet] [--bc]
+//                 [--ensemble n] [--log every_n] [--traj file] [--traj-every n]
+//                 [--adaptive dp54|bs32] [--rtol r] [--atol a] [--angular] [--fast-trig]
+//                 [--chain n] [--checkpoint file] [--checkpoint-every n] [--resume file] [--seek t]
+//                 [--max-drift d] [--max-energy-error e] [--max-constraint c]
+//
+// With --ensemble the run steps n pendulums at once through the SIMD kernels
+// in ensemble.cpp (rk4 or verlet only) and reports pendulum-steps per second.
+// ph.log is off unless --log is given. --traj records the single-pendulum
+// run to a binary trajectory file (see trajectory.hpp and tools/trajdump.cpp).
+// --chain and --ensemble refuse --traj and --traj-every, and they and
+// --adaptive refuse --log.
+//
+// --adaptive integrates the same simulated time (dt*steps) with an embedded
+// Runge-Kutta pair from adaptive.hpp, choosing its own step sizes within the
+// tolerances; --traj then samples the dense output every dt*traj-every.
+//
+// --angular integrates the angle and angular velocity instead of x/z (see
+// AngularPendulumForce) with the selected scheme and builds the Cartesian
+// state only for --traj and ph.log. --bc does not apply to it. With
+// --ensemble it selects Ensemble::IntegrateAngleRK4 (rk4 only).
+//
+// --chain steps an n-link chain of total length L (see chain.hpp) with the
+// selected scheme, starting with every link at theta0, and reports
+// link-steps per second.
+//
+// --checkpoint writes a snapshot of the single-pendulum run (see
+// checkpoint.hpp) at the start and every --checkpoint-every steps. --resume
+// continues a checkpointed run from its last snapshot for another --steps
+// steps, with the dt, integrator, --angular and --bc of that run. With --seek
+// it instead restores the last snapshot at or before time t, integrates
+// forward to t and stops there; the result is the same, bit for bit, as the
+// original run at that time. Final states are printed with 9 digits so runs
+// can be compared exactly. --chain, --ensemble and --adaptive runs cannot be
+// checkpointed; combining them with these options is an error.
+//
+// --fast-trig swaps libm sin/cos/atan in the force model for the
+// polynomials of fastmath.hpp (see setFastTrig).
+//
+// --ensemble prints the final position of the first pendulum and the
+// pendulum-steps per second. Every other mode prints its force evaluations,
+// and a ConservationMonitor (monitor.hpp) follows the run and prints the
+// energy error statistics (the worst error among them), the energy drift per
+// period, the worst constraint error and the change of the vertical angular
+// momentum. --max-drift, --max-energy-error and
+// --max-constraint set its alarms; a raised alarm is reported as it happens
+// and makes the exit status 2. Chains are judged in periods of a simple
+// pendulum of length L.
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "../physics.hpp"
+#include "../ensemble.hpp"
+#include "../trajectory.hpp"
+#include "../simd.hpp"
+#include "../adaptive.hpp"
+#include "../chain.hpp"
+#include "../checkpoint.hpp"
+#include "../monitor.hpp"
+
+static void usage(const char *prog) {
+	std::cerr << "usage: " << prog << " [--dt seconds] [--steps n] [--integrator euler|rk4|verlet] [--bc] [--ensemble n] [--log every_n]"
+	          << " [--traj file] [--traj-every n] [--adaptive dp54|bs32] [--rtol r] [--atol a] [--angular] [--fast-trig]"
+	          << " [--chain n] [--checkpoint file] [--checkpoint-every n] [--resume file] [--seek t]"
+	          << " [--max-drift d] [--max-energy-error e] [--max-constraint c]" << std::endl;
+}
+
+static void reportAlarms(unsigned raised, double time) {
+	for (unsigned bit = 1; raised; bit <<= 1){
+		if (raised & bit){
+			std::cerr << "t = " << time << " s: " << monitorAlarmName(bit) << " alarm" << std::endl;
+			raised &= ~bit;
+		}
+	}
+}
+
+// prints the monitor's summary; the exit status is 2 if it raised an alarm
+static int monitorStatus(const ConservationMonitor &monitor) {
+	monitor.printReport(std::cout);
+	return monitor.getAlarms() ? 2 : 0;
+}
+
+// energy of a unit mass from its angle state, m(L^2 w^2/2 + g L (1 - cos))
+static double angleEnergy(const PhaseState<float> &angle) {
+	return 0.5*L*L*angle.v*angle.v + gravity*L*(1.0 - std::cos((double)angle.x));
+}
+
+// Checkpoints of the single-pendulum runs. A snapshot holds the pendulum's
+// Body and its angle state (theta, omega, alpha), the layout the viewer
+// writes ahead of its ensemble and chain, so either can resume the other.
+struct Checkpointing
+{
+	const char *path;
+	long long every;
+	CheckpointWriter writer;
+	const Snapshot *resume;
+};
+
+static void saveSnapshot(Checkpointing &ck, long long step, float dt, const Body &body, const PhaseState<float> &angle) {
+	if (!ck.writer.isOpen()){
+		return;
+	}
+	Snapshot snap;
+	snap.time = (double)dt*step;
+	snap.step = step;
+	snap.bodies.push_back(body);
+	snap.values.push_back(angle.x);
+	snap.values.push_back(angle.v);
+	snap.values.push_back(angle.a);
+	if (!ck.writer.write(snap)){
+		std::cerr << "cannot write " << ck.path << std::endl;
+		ck.writer.close();
+	}
+}
+
+static std::ostream &operator<<(std::ostream &out, const glm::vec3 &v) {
+	std::streamsize precision = out.precision(9);
+	out << v.x << "  " << v.y << "  " << v.z;
+	out.precision(precision);
+	return out;
+}
+
+static int runEnsemble(int n, float dt, long long steps, Integrator integrator, bool angular) {
+	if (integrator == INTEGRATOR_EULER || (angular && integrator != INTEGRATOR_RK4)){
+		std::cerr << "the ensemble supports rk4 and verlet only, and rk4 only in angle space" << std::endl;
+		return 1;
+	}
+	Ensemble ensemble;
+	ensemble.init(n,puntofijo,gravity);
+	for (int i = 0; i < n; ++i){
+		ensemble.setPendulum(i,theta0,0.0f,L,1.0f);
+	}
+
+	auto t_start = std::chrono::high_resolution_clock::now();
+	for (long long k = 0; k < steps; ++k){
+		if (angular){
+			ensemble.IntegrateAngleRK4(dt);
+		} else if (integrator == INTEGRATOR_RK4){
+			ensemble.IntegrateRK4(dt);
+		} else {
+			ensemble.IntegrateVerlet(dt);
+		}
+	}
+	auto t_end = std::chrono::high_resolution_clock::now();
+	double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(t_end - t_start).count();
+
+	glm::vec3 p = ensemble.getPosition(0);
+	std::cout << "integrator: " << integratorName(integrator) << (angular ? " (angle space)" : "")
+	          << "  simd: " << SIMD_NAME << "  fast trig: " << (getFastTrig() ? "on" : "off") << std::endl;
+	std::cout << "pendulums: " << n << "  dt: " << dt << "  steps: " << steps << "  simulated time: " << dt*steps << " s" << std::endl;
+	std::cout << "final position[0]: " << p.x << "  " << p.y << "  " << p.z << std::endl;
+	std::cout << "wall time: " << seconds << " s  pendulum-steps/s: " << (double)n*steps/seconds << std::endl;
+	return 0;
+}
+
+template<typename T>
+static int runAdaptive(const char *name, int trajIntegrator, float dt, long long steps, float rtol, float atol,
+                       const char *trajPath, long long trajEvery, const MonitorThresholds &limits) {
+	Body sphere1;
+	initPendulum(sphere1);
+	ConservationMonitor monitor;
+	monitor.init(sphere1);
+	monitor.setThresholds(limits);
+	PendulumForce force = { defaultParams, getFastTrig() };
+	PhaseState<glm::vec3> s0 = { sphere1.getPosition(), sphere1.getVelocity(), sphere1.getAcceleration() };
+	AdaptiveIntegrator<T, glm::vec3, PendulumForce> solver;
+	solver.init(s0, 0.0, force, rtol, atol, dt);
+
+	TrajectoryWriter traj;
+	if (trajPath){
+		if (!traj.open(trajPath,makeTrajHeader(0.0f,trajIntegrator,dt*trajEvery))){
+			std::cerr << "cannot write " << trajPath << std::endl;
+			return 1;
+		}
+		traj.append(sphere1,0.0);
+	}
+
+	double endTime = (double)dt*steps;
+	double sampleDt = (double)dt*trajEvery;
+	long long nextSample = 1;
+	auto t_start = std::chrono::high_resolution_clock::now();
+	while (solver.getTime() < endTime){
+		solver.step(float(endTime - solver.getTime()));
+		const PhaseState<glm::vec3> &s = solver.getState();
+		sphere1.setPosition(s.x);
+		sphere1.setVelocity(s.v);
+		sphere1.setAcceleration(s.a);
+		if (unsigned raised = monitor.update(sphere1,solver.getTime())){
+			reportAlarms(raised,solver.getTime());
+		}
+		// samples that fell inside the step come from the dense output
+		while (trajPath && nextSample*sampleDt <= solver.getTime()){
+			Body sample = sphere1;
+			glm::vec3 x, v;
+			solver.interpolate(nextSample*sampleDt,x,v);
+			sample.setPosition(x);
+			sample.setVelocity(v);
+			sample.setAcceleration(force(x,v));
+			traj.append(sample,nextSample*sampleDt);
+			nextSample++;
+		}
+	}
+	auto t_end = std::chrono::high_resolution_clock::now();
+	double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(t_end - t_start).count();
+	traj.close();
+
+	glm::vec3 p = sphere1.getPosition();
+	glm::vec3 v = sphere1.getVelocity();
+	std::cout << "integrator: " << name << "  rtol: " << rtol << "  atol: " << atol << std::endl;
+	std::cout << "simulated time: " << endTime << " s  accepted: " << solver.getAccepted()
+	          << "  rejected: " << solver.getRejected() << "  mean dt: " << endTime/solver.getAccepted() << std::endl;
+	std::cout << "final position: " << p.x << "  " << p.y << "  " << p.z << std::endl;
+	std::cout << "final velocity: " << v.x << "  " << v.y << "  " << v.z << std::endl;
+	std::cout << "force evaluations: " << solver.getEvaluations() << std::endl;
+	std::cout << "wall time: " << seconds << " s" << std::endl;
+	return monitorStatus(monitor);
+}
+
+template<typename S>
+static int runAngular(Integrator integrator, float dt, long long steps, unsigned logSampling,
+                      const char *trajPath, long long trajEvery, Checkpointing &ck, const MonitorThresholds &limits) {
+	Body sphere1;
+	PhaseState<float> angle = initAngle();
+	long long first = 0;
+	if (ck.resume){
+		angle.x = ck.resume->values[0];
+		angle.v = ck.resume->values[1];
+		angle.a = ck.resume->values[2];
+		first = ck.resume->step;
+	}
+	setPendulumAngle(sphere1,angle.x,angle.v);
+	// the rod length and Lz are exact by construction, only energy can drift
+	ConservationMonitor monitor;
+	double e0 = angleEnergy(angle);
+	monitor.init(e0,0.0,pendulumPeriod(pendulumAmplitude(e0,1.0)),(double)dt*first);
+	monitor.setThresholds(limits);
+
+	TrajectoryWriter traj;
+	if (trajPath){
+		if (!traj.open(trajPath,makeTrajHeader(dt,integrator,dt*trajEvery))){
+			std::cerr << "cannot write " << trajPath << std::endl;
+			return 1;
+		}
+		traj.append(sphere1,(double)dt*first);
+	}
+	saveSnapshot(ck,first,dt,sphere1,angle);
+
+	auto t_start = std::chrono::high_resolution_clock::now();
+	for (long long n = first; n < first + steps; ++n){
+		IntegrateAngle<S>(angle,dt);
+		if (unsigned raised = monitor.update((double)dt*(n+1),angleEnergy(angle))){
+			reportAlarms(raised,(double)dt*(n+1));
+		}
+		bool sample = trajPath && (n+1) % trajEvery == 0;
+		if (sample || logSampling > 0){
+			setPendulumAngle(sphere1,angle.x,angle.v);
+		}
+		if (sample){
+			traj.append(sphere1,(double)dt*(n+1));
+		}
+		if (ck.every > 0 && (n+1) % ck.every == 0){
+			setPendulumAngle(sphere1,angle.x,angle.v);
+			saveSnapshot(ck,n+1,dt,sphere1,angle);
+		}
+	}
+	auto t_end = std::chrono::high_resolution_clock::now();
+	double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(t_end - t_start).count();
+	stopPhysicsLog();
+	traj.close();
+
+	setPendulumAngle(sphere1,angle.x,angle.v);
+	glm::vec3 p = sphere1.getPosition();
+	glm::vec3 v = sphere1.getVelocity();
+	int evaluations = integrator == INTEGRATOR_RK4 ? 4 : 1;
+	std::cout << "integrator: " << integratorName(integrator) << " (angle space)" << std::endl;
+	std::cout << "dt: " << dt << "  steps: " << steps << "  simulated time: " << (double)dt*(first + steps) << " s" << std::endl;
+	std::cout << "final theta: " << angle.x*180.0f/glm::pi<float>() << " deg  omega: " << angle.v << " rad/s  |r|-L: "
+	          << glm::distance(p,puntofijo) - L << std::endl;
+	std::cout << "final position: " << p << std::endl;
+	std::cout << "final velocity: " << v << std::endl;
+	std::cout << "force evaluations: " << steps*evaluations << std::endl;
+	std::cout << "wall time: " << seconds << " s  steps/s: " << steps/seconds << std::endl;
+	if (logSampling > 0){
+		std::cout << "ph.log records dropped: " << getPhysicsLogDropped() << std::endl;
+	}
+	return monitorStatus(monitor);
+}
+
+template<typename S>
+static int runChain(int n, Integrator integrator, float dt, long long steps, const MonitorThresholds &limits) {
+	PendulumChain chain;
+	chain.init(n);
+	for (int i = 0; i < n; ++i){
+		chain.setLink(i,theta0,0.0f,L/n,1.0f);
+	}
+	chain.updateAcceleration();
+	ConservationMonitor monitor;
+	monitor.init(chain.energy(),0.0,pendulumPeriod(theta0));
+	monitor.setThresholds(limits);
+
+	auto t_start = std::chrono::high_resolution_clock::now();
+	for (long long k = 0; k < steps; ++k){
+		chain.step<S>(dt);
+		if (unsigned raised = monitor.update((double)dt*(k+1),chain.energy())){
+			reportAlarms(raised,(double)dt*(k+1));
+		}
+	}
+	auto t_end = std::chrono::high_resolution_clock::now();
+	double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(t_end - t_start).count();
+
+	std::vector<glm::vec3> points;
+	chain.getPositions(points);
+	glm::vec3 p = points[n];
+	std::cout << "integrator: " << integratorName(integrator) << " (chain)" << std::endl;
+	std::cout << "links: " << n << "  dt: " << dt << "  steps: " << steps << "  simulated time: " << dt*steps << " s" << std::endl;
+	std::cout << "final tip position: " << p.x << "  " << p.y << "  " << p.z << std::endl;
+	std::cout << "force evaluations: " << chain.getEvaluations() << std::endl;
+	std::cout << "wall time: " << seconds << " s  link-steps/s: " << (double)n*steps/seconds << std::endl;
+	return monitorStatus(monitor);
+}
+
+int main(int argc, char **argv) {
+	float dt = 0.001f;
+	long long steps = 1000000;
+	Integrator integrator = INTEGRATOR_RK4;
+	bool checkBC = false;
+	int ensembleSize = 0;
+	unsigned logSampling = 0;
+	const char *trajPath = 0;
+	long long trajEvery = 1;
+	const char *adaptive = 0;
+	float rtol = 1e-6f;
+	float atol = 1e-6f;
+	bool angular = false;
+	int chainLinks = 0;
+	Checkpointing ck = {};
+	const char *resumePath = 0;
+	double seekTime = -1.0;
+	MonitorThresholds limits = { 0.0, 0.0, 0.0, 0.0 };
+
+	for (int i = 1; i < argc; ++i){
+		if (strcmp(argv[i],"--dt") == 0 && i+1 < argc){
+			dt = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i],"--steps") == 0 && i+1 < argc){
+			steps = atoll(argv[++i]);
+		} else if (strcmp(argv[i],"--integrator") == 0 && i+1 < argc){
+			if (!parseIntegrator(argv[++i],integrator)){
+				std::cerr << "unknown integrator: " << argv[i] << std::endl;
+				return 1;
+			}
+		} else if (strcmp(argv[i],"--bc") == 0){
+			checkBC = true;
+		} else if (strcmp(argv[i],"--ensemble") == 0 && i+1 < argc){
+			ensembleSize = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--log") == 0 && i+1 < argc){
+			logSampling = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--traj") == 0 && i+1 < argc){
+			trajPath = argv[++i];
+		} else if (strcmp(argv[i],"--traj-every") == 0 && i+1 < argc){
+			trajEvery = atoll(argv[++i]);
+		} else if (strcmp(argv[i],"--adaptive") == 0 && i+1 < argc){
+			adaptive = argv[++i];
+		} else if (strcmp(argv[i],"--rtol") == 0 && i+1 < argc){
+			rtol = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i],"--atol") == 0 && i+1 < argc){
+			atol = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i],"--angular") == 0){
+			angular = true;
+		} else if (strcmp(argv[i],"--fast-trig") == 0){
+			setFastTrig(true);
+		} else if (strcmp(argv[i],"--chain") == 0 && i+1 < argc){
+			chainLinks = atoi(argv[++i]);
+		} else if (strcmp(argv[i],"--checkpoint") == 0 && i+1 < argc){
+			ck.path = argv[++i];
+		} else if (strcmp(argv[i],"--checkpoint-every") == 0 && i+1 < argc){
+			ck.every = atoll(argv[++i]);
+		} else if (strcmp(argv[i],"--resume") == 0 && i+1 < argc){
+			resumePath = argv[++i];
+		} else if (strcmp(argv[i],"--seek") == 0 && i+1 < argc){
+			seekTime = atof(argv[++i]);
+		} else if (strcmp(argv[i],"--max-drift") == 0 && i+1 < argc){
+			limits.energyDrift = atof(argv[++i]);
+		} else if (strcmp(argv[i],"--max-energy-error") == 0 && i+1 < argc){
+			limits.energyError = atof(argv[++i]);
+		} else if (strcmp(argv[i],"--max-constraint") == 0 && i+1 < argc){
+			limits.constraintError = atof(argv[++i]);
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (dt <= 0.0f || steps <= 0 || trajEvery <= 0){
+		usage(argv[0]);
+		return 1;
+	}
+
+	if ((ck.path || resumePath || seekTime >= 0.0) && (chainLinks > 0 || ensembleSize > 0 || adaptive)){
+		std::cerr << "--checkpoint, --resume and --seek apply to the fixed-step single-pendulum runs only" << std::endl;
+		return 1;
+	}
+	if ((trajPath || trajEvery != 1) && (chainLinks > 0 || ensembleSize > 0)){
+		std::cerr << "--traj and --traj-every apply to the single-pendulum runs only" << std::endl;
+		return 1;
+	}
+	if (logSampling > 0 && (chainLinks > 0 || ensembleSize > 0 || adaptive)){
+		std::cerr << "--log applies to the fixed-step single-pendulum runs only" << std::endl;
+		return 1;
+	}
+
+	if (chainLinks > 0){
+		switch (integrator){
+			case INTEGRATOR_EULER:
+				return runChain<Euler>(chainLinks,integrator,dt,steps,limits);
+			case INTEGRATOR_RK4:
+				return runChain<RK4>(chainLinks,integrator,dt,steps,limits);
+			case INTEGRATOR_VERLET:
+				return runChain<VelocityVerlet>(chainLinks,integrator,dt,steps,limits);
+		}
+	}
+	if (ensembleSize > 0){
+		return runEnsemble(ensembleSize,dt,steps,integrator,angular);
+	}
+	if (adaptive){
+		if (rtol <= 0.0f || atol <= 0.0f){
+			usage(argv[0]);
+			return 1;
+		}
+		if (strcmp(adaptive,"dp54") == 0){
+			return runAdaptive<DormandPrince54Tableau>("dp54",TRAJ_INTEGRATOR_DP54,dt,steps,rtol,atol,trajPath,trajEvery,limits);
+		}
+		if (strcmp(adaptive,"bs32") == 0){
+			return runAdaptive<BogackiShampine32Tableau>("bs32",TRAJ_INTEGRATOR_BS32,dt,steps,rtol,atol,trajPath,trajEvery,limits);
+		}
+		std::cerr << "unknown adaptive integrator: " << adaptive << std::endl;
+		return 1;
+	}
+
+	// a resumed run takes its configuration from the checkpoint
+	Snapshot resume;
+	if (resumePath){
+		CheckpointReader reader;
+		if (!reader.open(resumePath) || reader.size() == 0){
+			std::cerr << "cannot resume from " << resumePath << std::endl;
+			return 1;
+		}
+		const CheckpointHeader &h = reader.getHeader();
+		if (h.ensembleSize != 0 || h.chainLinks != 0 || h.substeps != 1 ||
+		    h.integrator < INTEGRATOR_EULER || h.integrator > INTEGRATOR_VERLET){
+			std::cerr << resumePath << " is not a single-pendulum checkpoint" << std::endl;
+			return 1;
+		}
+		size_t index = seekTime >= 0.0 ? reader.findTime(seekTime) : reader.size() - 1;
+		if (!reader.read(index,resume) || resume.bodies.size() != 1 || resume.values.size() != 3){
+			std::cerr << "cannot read snapshot " << index << " of " << resumePath << std::endl;
+			return 1;
+		}
+		dt = h.dt;
+		integrator = (Integrator)h.integrator;
+		angular = !(h.flags & CKPT_CARTESIAN);
+		checkBC = (h.flags & CKPT_CHECK_BC) != 0;
+		if (seekTime >= 0.0){
+			steps = std::max(0LL, std::llround(seekTime/dt) - resume.step);
+		}
+		std::cout << "resumed from " << resumePath << " at t = " << resume.time << " s (step " << resume.step << ")" << std::endl;
+		ck.resume = &resume;
+	} else if (seekTime >= 0.0){
+		std::cerr << "--seek needs --resume" << std::endl;
+		return 1;
+	}
+	if (ck.path){
+		CheckpointHeader h = makeCheckpointHeader(dt,integrator,1);
+		h.flags = (angular ? 0 : CKPT_CARTESIAN) | (checkBC ? CKPT_CHECK_BC : 0);
+		h.bodyCount = 1;
+		if (!ck.writer.open(ck.path,h)){
+			std::cerr << "cannot write " << ck.path << std::endl;
+			return 1;
+		}
+	}
+
+	if (logSampling > 0 && !startPhysicsLog(logSampling)){
+		std::cerr << "cannot open " << PH_LOG_FILE << std::endl;
+		return 1;
+	}
+
+	if (angular){
+		switch (integrator){
+			case INTEGRATOR_EULER:
+				return runAngular<Euler>(integrator,dt,steps,logSampling,trajPath,trajEvery,ck,limits);
+			case INTEGRATOR_RK4:
+				return runAngular<RK4>(integrator,dt,steps,logSampling,trajPath,trajEvery,ck,limits);
+			case INTEGRATOR_VERLET:
+				return runAngular<VelocityVerlet>(integrator,dt,steps,logSampling,trajPath,trajEvery,ck,limits);
+		}
+	}
+
+	Body sphere1;
+	initPendulum(sphere1);
+	long long first = 0;
+	if (ck.resume){
+		sphere1 = ck.resume->bodies[0];
+		first = ck.resume->step;
+	}
+	ConservationMonitor monitor;
+	monitor.init(sphere1,(double)dt*first);
+	monitor.setThresholds(limits);
+
+	TrajectoryWriter traj;
+	if (trajPath){
+		if (!traj.open(trajPath,makeTrajHeader(dt,integrator,dt*trajEvery))){
+			std::cerr << "cannot write " << trajPath << std::endl;
+			return 1;
+		}
+		traj.append(sphere1,(double)dt*first);
+	}
+	// the angle state is only informative for a Cartesian run
+	PhaseState<float> angle = { pendulumAngle(sphere1), pendulumAngularVelocity(sphere1), 0.0f };
+	saveSnapshot(ck,first,dt,sphere1,angle);
+
+	auto t_start = std::chrono::high_resolution_clock::now();
+	for (long long n = first; n < first + steps; ++n){
+		Integrate(sphere1,dt,integrator);
+		if (checkBC){
+			CheckBC(sphere1);
+		}
+		if (unsigned raised = monitor.update(sphere1,(double)dt*(n+1))){
+			reportAlarms(raised,(double)dt*(n+1));
+		}
+		if (trajPath && (n+1) % trajEvery == 0){
+			traj.append(sphere1,(double)dt*(n+1));
+		}
+		if (ck.every > 0 && (n+1) % ck.every == 0){
+			angle.x = pendulumAngle(sphere1);
+			angle.v = pendulumAngularVelocity(sphere1);
+			saveSnapshot(ck,n+1,dt,sphere1,angle);
+		}
+	}
+	auto t_end = std::chrono::high_resolution_clock::now();
+	double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(t_end - t_start).count();
+	stopPhysicsLog();
+	traj.close();
+
+	glm::vec3 p = sphere1.getPosition();
+	glm::vec3 v = sphere1.getVelocity();
+	std::cout << "integrator: " << integratorName(integrator) << std::endl;
+	std::cout << "dt: " << dt << "  steps: " << steps << "  simulated time: " << (double)dt*(first + steps) << " s" << std::endl;
+	std::cout << "final position: " << p << std::endl;
+	std::cout << "final velocity: " << v << std::endl;
+	std::cout << "force evaluations: " << steps*(integrator == INTEGRATOR_RK4 ? 4 : 1) << std::endl;
+	std::cout << "wall time: " << seconds << " s  steps/s: " << steps/seconds << std::endl;
+	if (logSampling > 0){
+		std::cout << "ph.log records dropped: " << getPhysicsLogDropped() << std::endl;
+	}
+	return monitorStatus(monitor);
+}
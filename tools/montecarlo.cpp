@@ -0,0 +1,165 @@
+// Propagates uncertain initial conditions through a large pendulum ensemble
+// and writes the mean, standard deviation, range and histogram of the angle,
+// angular velocity and energy at the requested output times. No trajectory
+// is stored, so millions of members run in a few megabytes.
+//
+// usage: montecarlo [--members n] [--seed s] [--theta0 dist] [--omega0 dist] [--L dist]
+//                   [--mass kg] [--gravity g] [--dt seconds] [--times t[,t...]|a:b:n]
+//                   [--integrator rk4|verlet] [--angular] [--bins n]
+//                   [--range theta|omega|energy lo:hi] [--threads n]
+//                   [--out stats.csv] [--hist histograms.csv]
+//
+// A dist is a fixed value v, uniform:a:b or normal:mean:sd; --theta0 is in
+// degrees, --omega0 in rad/s and --L in metres. Times a:b:n are n evenly
+// spaced times from a to b inclusive. The output is the same, bit for bit,
+// for any --threads (see MonteCarloEnsemble).
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../montecarlo.hpp"
+#include "../threadpool.hpp"
+
+static bool parseTimes(const char *text, std::vector<double> &times) {
+	double from, to;
+	int count;
+	char tail;
+	times.clear();
+	if (sscanf(text,"%lf:%lf:%d%c",&from,&to,&count,&tail) == 3){
+		for (int i = 0; i < count; ++i){
+			times.push_back(count > 1 ? from + (to - from)*i/(count - 1) : from);
+		}
+		return count > 0;
+	}
+	while (*text){
+		char *end;
+		times.push_back(strtod(text,&end));
+		if (end == text || (*end && *end != ',')){
+			return false;
+		}
+		text = *end ? end + 1 : end;
+	}
+	return !times.empty();
+}
+
+static bool parseRange(const char *name, const char *text, MonteCarloConfig &config) {
+	for (int q = 0; q < MC_QUANTITIES; ++q){
+		if (strcmp(name,monteCarloQuantityName(q)) == 0){
+			return sscanf(text,"%lf:%lf",&config.range[q][0],&config.range[q][1]) == 2 &&
+			       config.range[q][0] < config.range[q][1];
+		}
+	}
+	return false;
+}
+
+static void usage(const char *prog) {
+	std::cerr << "usage: " << prog << " [--members n] [--seed s] [--theta0 dist] [--omega0 dist] [--L dist]" << std::endl
+	          << "       [--mass kg] [--gravity g] [--dt seconds] [--times t[,t...]|a:b:n]" << std::endl
+	          << "       [--integrator rk4|verlet] [--angular] [--bins n] [--range theta|omega|energy lo:hi]" << std::endl
+	          << "       [--threads n] [--out stats.csv] [--hist histograms.csv]" << std::endl
+	          << "dist: v | uniform:a:b | normal:mean:sd (--theta0 in degrees)" << std::endl;
+}
+
+int main(int argc, char **argv) {
+	MonteCarloConfig config;
+	config.members = 100000;
+	config.times.push_back(10.0);
+	int threads = 0;
+	const char *outPath = 0;
+	const char *histPath = 0;
+	double degrees = glm::pi<double>()/180.0;
+
+	for (int i = 1; i < argc; ++i){
+		bool ok = i+1 < argc;
+		if (ok && strcmp(argv[i],"--members") == 0){
+			config.members = atoll(argv[++i]);
+		} else if (ok && strcmp(argv[i],"--seed") == 0){
+			config.seed = strtoull(argv[++i],0,0);
+		} else if (ok && strcmp(argv[i],"--theta0") == 0){
+			ok = parseDistribution(argv[++i],config.theta0,degrees);
+		} else if (ok && strcmp(argv[i],"--omega0") == 0){
+			ok = parseDistribution(argv[++i],config.omega0);
+		} else if (ok && strcmp(argv[i],"--L") == 0){
+			ok = parseDistribution(argv[++i],config.length);
+		} else if (ok && strcmp(argv[i],"--mass") == 0){
+			config.mass = (float)atof(argv[++i]);
+		} else if (ok && strcmp(argv[i],"--gravity") == 0){
+			config.gravity = (float)atof(argv[++i]);
+		} else if (ok && strcmp(argv[i],"--dt") == 0){
+			config.dt = (float)atof(argv[++i]);
+		} else if (ok && strcmp(argv[i],"--times") == 0){
+			ok = parseTimes(argv[++i],config.times);
+		} else if (ok && strcmp(argv[i],"--integrator") == 0){
+			ok = parseIntegrator(argv[++i],config.integrator);
+		} else if (strcmp(argv[i],"--angular") == 0){
+			config.angular = true;
+			ok = true;
+		} else if (ok && strcmp(argv[i],"--bins") == 0){
+			config.bins = atoi(argv[++i]);
+		} else if (i+2 < argc && strcmp(argv[i],"--range") == 0){
+			ok = parseRange(argv[i+1],argv[i+2],config);
+			i += 2;
+		} else if (ok && strcmp(argv[i],"--threads") == 0){
+			threads = atoi(argv[++i]);
+		} else if (ok && strcmp(argv[i],"--out") == 0){
+			outPath = argv[++i];
+		} else if (ok && strcmp(argv[i],"--hist") == 0){
+			histPath = argv[++i];
+		} else {
+			ok = false;
+		}
+		if (!ok){
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	MonteCarloEnsemble mc;
+	if (!mc.init(config)){
+		usage(argv[0]);
+		return 1;
+	}
+
+	ThreadPool pool;
+	pool.init(threads);
+	auto t_start = std::chrono::high_resolution_clock::now();
+	mc.run(pool);
+	auto t_end = std::chrono::high_resolution_clock::now();
+	double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(t_end - t_start).count();
+	threads = pool.size();
+	pool.cleanup();
+
+	if (outPath){
+		std::ofstream out(outPath);
+		if (!out){
+			std::cerr << "cannot write " << outPath << std::endl;
+			return 1;
+		}
+		mc.writeStats(out);
+	} else {
+		mc.writeStats(std::cout);
+	}
+	if (histPath){
+		std::ofstream hist(histPath);
+		if (!hist){
+			std::cerr << "cannot write " << histPath << std::endl;
+			return 1;
+		}
+		mc.writeHistograms(hist);
+	}
+
+	double memberSteps = (double)config.members*mc.getSteps();
+	std::cerr << config.members << " members x " << mc.getSteps() << " steps ("
+	          << (config.angular ? "angular " : "") << integratorName(config.integrator) << ") on "
+	          << threads << " threads: " << seconds << " s, " << memberSteps/seconds << " member-steps/s";
+	if (mc.getRedraws() > 0){
+		std::cerr << ", " << mc.getRedraws() << " lengths redrawn";
+	}
+	std::cerr << std::endl;
+	return 0;
+}
@@ -0,0 +1,231 @@
+// Runs a grid of headless pendulum simulations over initial angle, rod
+// length, gravity and mass on all cores and writes one CSV row per
+// configuration: measured period, amplitude decay and energy drift.
+//
+// usage: sweep [--theta0 deg[:deg:n]] [--L m[:m:n]] [--gravity g[:g:n]] [--mass kg[:kg:n]]
+//              [--dt seconds] [--time seconds] [--integrator euler|rk4|verlet]
+//              [--threads n] [--out file.csv]
+//
+// A value a:b:n sweeps n evenly spaced values from a to b inclusive; the grid
+// is the product of all four axes. Runs integrate the angle and angular
+// velocity (IntegrateAngle), which holds at any amplitude, so theta0 may be
+// anything short of the top, |theta0| < 180.
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../physics.hpp"
+#include "../integrators.hpp"
+#include "../threadpool.hpp"
+
+struct Axis
+{
+	float from, to;
+	int count;
+	float value(int i) const { return count > 1 ? from + (to - from)*i/(count - 1) : from; }
+};
+
+struct RunResult
+{
+	float theta0, L, gravity, mass;
+	double period;          // mean time between upward zero crossings, NaN if under two
+	double periodExact;     // large-amplitude period of the ideal pendulum
+	double amplitudeDecay;  // last half-swing amplitude over the first
+	double energyDrift;     // (E_end - E_0) / E_0
+	double maxEnergyError;  // max |E - E_0| / E_0
+};
+
+static bool parseAxis(const char *text, Axis &axis) {
+	int n = sscanf(text,"%f:%f:%d",&axis.from,&axis.to,&axis.count);
+	if (n == 1){
+		axis.to = axis.from;
+		axis.count = 1;
+		return true;
+	}
+	return n == 3 && axis.count > 0;
+}
+
+// T = 2*pi*sqrt(L/g) / agm(1, cos(theta0/2))
+static double exactPeriod(double theta0, double L, double g) {
+	double a = 1.0, b = std::cos(theta0/2.0);
+	for (int i = 0; i < 20 && std::fabs(a - b) > 1e-15; ++i){
+		double an = (a + b)/2.0;
+		b = std::sqrt(a*b);
+		a = an;
+	}
+	return 2.0*glm::pi<double>()*std::sqrt(L/g)/a;
+}
+
+// energy of the angle state, measured from the lowest point
+static double angleEnergy(const PhaseState<float> &s, double mass, const PendulumParams &p) {
+	return mass*(0.5*(double)p.L*p.L*s.v*s.v + (double)p.gravity*p.L*(1.0 - std::cos((double)s.x)));
+}
+
+template<typename S>
+static RunResult runConfiguration(float theta, float length, float g, float mass,
+                                  float dt, long long steps) {
+	PendulumParams p = { g, length, puntofijo };
+	PhaseState<float> bob = initAngle(theta,p);
+
+	RunResult res;
+	res.theta0 = theta;
+	res.L = length;
+	res.gravity = g;
+	res.mass = mass;
+	res.periodExact = exactPeriod(theta,length,g);
+
+	double e0 = angleEnergy(bob,mass,p);
+	double maxError = 0.0;
+	double firstCrossing = 0.0, lastCrossing = 0.0;
+	long long crossings = 0;
+	double peak = 0.0, firstPeak = -1.0, lastPeak = -1.0;
+	float prevAngle = bob.x;
+
+	for (long long n = 1; n <= steps; ++n){
+		IntegrateAngle<S>(bob,dt,p);
+		float angle = bob.x;
+		double e = angleEnergy(bob,mass,p);
+		if (std::fabs(e - e0) > maxError){
+			maxError = std::fabs(e - e0);
+		}
+		if (std::fabs(angle) > peak){
+			peak = std::fabs(angle);
+		}
+		if ((prevAngle < 0.0f) != (angle < 0.0f)){
+			// a half-swing ended: keep its peak, and time upward crossings
+			if (firstPeak < 0.0){
+				firstPeak = peak;
+			}
+			lastPeak = peak;
+			peak = 0.0;
+			if (prevAngle < 0.0f){
+				double t = dt*(n - 1 + (double)-prevAngle/(angle - prevAngle));
+				if (crossings == 0){
+					firstCrossing = t;
+				}
+				lastCrossing = t;
+				++crossings;
+			}
+		}
+		prevAngle = angle;
+	}
+
+	double ef = angleEnergy(bob,mass,p);
+	res.period = crossings >= 2 ? (lastCrossing - firstCrossing)/(crossings - 1) : NAN;
+	res.amplitudeDecay = firstPeak > 0.0 ? lastPeak/firstPeak : NAN;
+	res.energyDrift = e0 != 0.0 ? (ef - e0)/e0 : NAN;
+	res.maxEnergyError = e0 != 0.0 ? maxError/e0 : NAN;
+	return res;
+}
+
+static void usage(const char *prog) {
+	std::cerr << "usage: " << prog << " [--theta0 deg[:deg:n]] [--L m[:m:n]] [--gravity g[:g:n]] [--mass kg[:kg:n]]" << std::endl
+	          << "       [--dt seconds] [--time seconds] [--integrator euler|rk4|verlet] [--threads n] [--out file.csv]" << std::endl;
+}
+
+int main(int argc, char **argv) {
+	Axis thetaAxis = { 45.0f, 45.0f, 1 };
+	Axis lengthAxis = { L, L, 1 };
+	Axis gravityAxis = { gravity, gravity, 1 };
+	Axis massAxis = { 1.0f, 1.0f, 1 };
+	float dt = 0.001f;
+	float duration = 20.0f;
+	Integrator integrator = INTEGRATOR_RK4;
+	int threads = 0;
+	const char *outPath = 0;
+
+	for (int i = 1; i < argc; ++i){
+		bool ok = i+1 < argc;
+		if (ok && strcmp(argv[i],"--theta0") == 0){
+			ok = parseAxis(argv[++i],thetaAxis);
+		} else if (ok && strcmp(argv[i],"--L") == 0){
+			ok = parseAxis(argv[++i],lengthAxis);
+		} else if (ok && strcmp(argv[i],"--gravity") == 0){
+			ok = parseAxis(argv[++i],gravityAxis);
+		} else if (ok && strcmp(argv[i],"--mass") == 0){
+			ok = parseAxis(argv[++i],massAxis);
+		} else if (ok && strcmp(argv[i],"--dt") == 0){
+			dt = (float)atof(argv[++i]);
+		} else if (ok && strcmp(argv[i],"--time") == 0){
+			duration = (float)atof(argv[++i]);
+		} else if (ok && strcmp(argv[i],"--integrator") == 0){
+			ok = parseIntegrator(argv[++i],integrator);
+		} else if (ok && strcmp(argv[i],"--threads") == 0){
+			threads = atoi(argv[++i]);
+		} else if (ok && strcmp(argv[i],"--out") == 0){
+			outPath = argv[++i];
+		} else {
+			ok = false;
+		}
+		if (!ok){
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (dt <= 0.0f || duration <= 0.0f){
+		usage(argv[0]);
+		return 1;
+	}
+	if (std::max(std::fabs(thetaAxis.from),std::fabs(thetaAxis.to)) >= 180.0f){
+		std::cerr << "--theta0 must stay below 180 degrees: a pendulum at the top does not swing" << std::endl;
+		return 1;
+	}
+
+	long long steps = (long long)(duration/dt + 0.5f);
+	long long configs = (long long)thetaAxis.count*lengthAxis.count*gravityAxis.count*massAxis.count;
+	std::vector<RunResult> results(configs);
+
+	ThreadPool pool;
+	pool.init(threads);
+	long long grain = configs/(pool.size()*64LL);
+	auto t_start = std::chrono::high_resolution_clock::now();
+	pool.parallelFor(configs,grain > 0 ? grain : 1,[&](long long begin, long long end){
+		for (long long c = begin; c < end; ++c){
+			long long k = c;
+			int im = (int)(k % massAxis.count); k /= massAxis.count;
+			int ig = (int)(k % gravityAxis.count); k /= gravityAxis.count;
+			int il = (int)(k % lengthAxis.count); k /= lengthAxis.count;
+			int it = (int)k;
+			float theta = glm::radians(thetaAxis.value(it));
+			switch (integrator){
+				case INTEGRATOR_EULER:
+					results[c] = runConfiguration<Euler>(theta,lengthAxis.value(il),gravityAxis.value(ig),massAxis.value(im),dt,steps);
+					break;
+				case INTEGRATOR_RK4:
+					results[c] = runConfiguration<RK4>(theta,lengthAxis.value(il),gravityAxis.value(ig),massAxis.value(im),dt,steps);
+					break;
+				case INTEGRATOR_VERLET:
+					results[c] = runConfiguration<VelocityVerlet>(theta,lengthAxis.value(il),gravityAxis.value(ig),massAxis.value(im),dt,steps);
+					break;
+			}
+		}
+	});
+	auto t_end = std::chrono::high_resolution_clock::now();
+	double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(t_end - t_start).count();
+	threads = pool.size();
+	pool.cleanup();
+
+	FILE *out = stdout;
+	if (outPath && !(out = fopen(outPath,"w"))){
+		std::cerr << "cannot write " << outPath << std::endl;
+		return 1;
+	}
+	fprintf(out,"index,theta0_deg,L,gravity,mass,period,period_exact,amplitude_decay,energy_drift,max_energy_error\n");
+	for (long long c = 0; c < configs; ++c){
+		const RunResult &r = results[c];
+		fprintf(out,"%lld,%.6g,%.6g,%.6g,%.6g,%.9g,%.9g,%.9g,%.6g,%.6g\n",c,r.theta0*180.0f/glm::pi<float>(),
+			r.L,r.gravity,r.mass,r.period,r.periodExact,r.amplitudeDecay,r.energyDrift,r.maxEnergyError);
+	}
+	if (out != stdout){
+		fclose(out);
+	}
+	std::cerr << configs << " configurations x " << steps << " steps (" << integratorName(integrator) << ") on "
+	          << threads << " threads: " << seconds << " s, " << configs/seconds << " configurations/s" << std::endl;
+	return 0;
+}
@@ -0,0 +1,74 @@
+// Prints the header of a binary trajectory file and dumps a range of its
+// records as CSV without reading the rest of the file.
+//
+// usage: trajdump file.traj [--info] [--from step] [--to step] [--every n]
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../trajectory.hpp"
+#include "../physics.hpp"
+
+static void usage(const char *prog) {
+	std::cerr << "usage: " << prog << " file.traj [--info] [--from step] [--to step] [--every n]" << std::endl;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2){
+		usage(argv[0]);
+		return 1;
+	}
+	bool infoOnly = false;
+	unsigned long long from = 0;
+	unsigned long long to = ~0ULL;
+	unsigned long long every = 1;
+	for (int i = 2; i < argc; ++i){
+		if (strcmp(argv[i],"--info") == 0){
+			infoOnly = true;
+		} else if (strcmp(argv[i],"--from") == 0 && i+1 < argc){
+			from = strtoull(argv[++i],0,10);
+		} else if (strcmp(argv[i],"--to") == 0 && i+1 < argc){
+			to = strtoull(argv[++i],0,10);
+		} else if (strcmp(argv[i],"--every") == 0 && i+1 < argc){
+			every = strtoull(argv[++i],0,10);
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (every == 0){
+		every = 1;
+	}
+
+	TrajectoryReader reader;
+	if (!reader.open(argv[1])){
+		std::cerr << "cannot read trajectory " << argv[1] << std::endl;
+		return 1;
+	}
+	const TrajHeader &h = reader.getHeader();
+	if (infoOnly){
+		std::cout << "records: " << reader.size() << std::endl;
+		std::cout << "integrator: " << trajIntegratorName(h.integrator) << "  dt: " << h.dt
+		          << "  sample interval: " << (h.sampleInterval > 0.0f ? h.sampleInterval : h.dt) << std::endl;
+		std::cout << "gravity: " << h.gravity << "  L: " << h.L << "  R: " << h.R << "  theta0: " << h.theta0 << "  mass: " << h.mass << std::endl;
+		std::cout << "puntofijo: " << h.puntofijo[0] << "  " << h.puntofijo[1] << "  " << h.puntofijo[2] << std::endl;
+		if (reader.size() > 0){
+			std::cout << "time: " << reader[0].time << " .. " << reader[reader.size()-1].time << std::endl;
+		}
+		return 0;
+	}
+
+	if (to >= reader.size()){
+		to = reader.size() - 1;
+	}
+	printf("step,time,x,y,z,vx,vy,vz,ax,ay,az\n");
+	for (unsigned long long i = from; i <= to && i < reader.size(); i += every){
+		const TrajRecord &r = reader[i];
+		printf("%llu,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n", i, r.time,
+			r.position[0], r.position[1], r.position[2],
+			r.velocity[0], r.velocity[1], r.velocity[2],
+			r.acceleration[0], r.acceleration[1], r.acceleration[2]);
+	}
+	return 0;
+}
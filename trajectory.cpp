@@ -0,0 +1,223 @@
+#include "trajectory.hpp"
+#include "physics.hpp"
+
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const size_t flushRecords = 4096;
+
+TrajHeader makeTrajHeader(float dt, int integrator, float sampleInterval)
+{
+    TrajHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TRAJ_MAGIC, sizeof(TRAJ_MAGIC));
+    h.version = TRAJ_VERSION;
+    h.headerSize = sizeof(TrajHeader);
+    h.recordSize = sizeof(TrajRecord);
+    h.integrator = integrator;
+    h.gravity = gravity;
+    h.L = L;
+    h.R = R;
+    h.theta0 = theta0;
+    h.dt = dt;
+    h.mass = 1.0f;
+    h.puntofijo[0] = puntofijo.x;
+    h.puntofijo[1] = puntofijo.y;
+    h.puntofijo[2] = puntofijo.z;
+    h.sampleInterval = sampleInterval;
+    return h;
+}
+
+const char *trajIntegratorName(int integrator)
+{
+    switch (integrator) {
+        case TRAJ_INTEGRATOR_DP54: return "dp54";
+        case TRAJ_INTEGRATOR_BS32: return "bs32";
+    }
+    return integratorName((Integrator)integrator);
+}
+
+TrajectoryWriter::TrajectoryWriter()
+{
+    memset(&header, 0, sizeof(header));
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    close();
+}
+
+bool TrajectoryWriter::open(const char *path, const TrajHeader &h)
+{
+    close();
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    header = h;
+    header.recordCount = 0;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    pending.reserve(flushRecords);
+    return file.good();
+}
+
+void TrajectoryWriter::append(const Body &body, double time)
+{
+    TrajRecord rec;
+    glm::vec3 p = body.getPosition();
+    glm::vec3 v = body.getVelocity();
+    glm::vec3 a = body.getAcceleration();
+    rec.time = time;
+    rec.position[0] = p.x; rec.position[1] = p.y; rec.position[2] = p.z;
+    rec.velocity[0] = v.x; rec.velocity[1] = v.y; rec.velocity[2] = v.z;
+    rec.acceleration[0] = a.x; rec.acceleration[1] = a.y; rec.acceleration[2] = a.z;
+    rec.reserved = 0.0f;
+    pending.push_back(rec);
+    if (pending.size() >= flushRecords) {
+        flush();
+    }
+}
+
+void TrajectoryWriter::flush()
+{
+    if (pending.empty()) {
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(&pending[0]), pending.size() * sizeof(TrajRecord));
+    header.recordCount += pending.size();
+    pending.clear();
+}
+
+// writes what is still buffered and patches the record count into the header
+void TrajectoryWriter::close()
+{
+    if (!file.is_open()) {
+        return;
+    }
+    flush();
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+}
+
+TrajectoryReader::TrajectoryReader()
+{
+    base = 0;
+    header = 0;
+    length = 0;
+    count = 0;
+#ifdef _WIN32
+    fileHandle = INVALID_HANDLE_VALUE;
+    mappingHandle = 0;
+#else
+    fd = -1;
+#endif
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+    close();
+}
+
+bool TrajectoryReader::open(const char *path)
+{
+    close();
+#ifdef _WIN32
+    fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(TrajHeader)) {
+        close();
+        return false;
+    }
+    length = fileSize.QuadPart;
+    mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mappingHandle) {
+        close();
+        return false;
+    }
+    base = static_cast<const unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+#else
+    fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(TrajHeader)) {
+        close();
+        return false;
+    }
+    length = st.st_size;
+    void *p = mmap(0, length, PROT_READ, MAP_SHARED, fd, 0);
+    base = p == MAP_FAILED ? 0 : static_cast<const unsigned char*>(p);
+#endif
+    if (!base) {
+        close();
+        return false;
+    }
+
+    header = reinterpret_cast<const TrajHeader*>(base);
+    if (memcmp(header->magic, TRAJ_MAGIC, sizeof(TRAJ_MAGIC)) != 0 || header->version != TRAJ_VERSION ||
+        header->headerSize < sizeof(TrajHeader) || header->recordSize < sizeof(TrajRecord) ||
+        header->headerSize > length) {
+        close();
+        return false;
+    }
+    count = (length - header->headerSize) / header->recordSize;
+    return true;
+}
+
+void TrajectoryReader::close()
+{
+#ifdef _WIN32
+    if (base) {
+        UnmapViewOfFile(base);
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+    }
+    mappingHandle = 0;
+    fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if (base) {
+        munmap(const_cast<unsigned char*>(base), length);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+#endif
+    base = 0;
+    header = 0;
+    length = 0;
+    count = 0;
+}
+
+uint64_t TrajectoryReader::findTime(double t) const
+{
+    uint64_t lo = 0, hi = count;
+    while (hi - lo > 1) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if ((*this)[mid].time <= t) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
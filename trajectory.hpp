@@ -0,0 +1,108 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+#include "body.hpp"
+
+// Binary trajectory file: one TrajHeader followed by fixed-size TrajRecords,
+// all little-endian as written by the host. Record i starts at
+// header.headerSize + i*header.recordSize, so a mapped file can be indexed
+// by step directly.
+
+#define TRAJ_MAGIC "PNDTRAJ"
+#define TRAJ_VERSION 1
+
+// integrator ids of adaptive runs, next to the fixed-step Integrator values
+#define TRAJ_INTEGRATOR_DP54 100
+#define TRAJ_INTEGRATOR_BS32 101
+
+struct TrajHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t recordSize;
+    int32_t integrator;
+    uint64_t recordCount;   // informative only, readers trust the file size
+    float gravity;
+    float L;
+    float R;
+    float theta0;
+    float dt;               // integration step, 0 for adaptive runs whose step varies
+    float mass;
+    float puntofijo[3];
+    float sampleInterval;   // simulated time between records; 0 (older files) is every step
+    uint32_t reserved[20];
+};
+
+struct TrajRecord
+{
+    double time;
+    float position[3];
+    float velocity[3];
+    float acceleration[3];
+    float reserved;
+};
+
+static_assert(sizeof(TrajHeader) == 152, "TrajHeader layout changed");
+static_assert(sizeof(TrajRecord) == 48, "TrajRecord layout changed");
+
+// fills a header with the compile-time parameters from physics.hpp
+TrajHeader makeTrajHeader(float dt, int integrator, float sampleInterval);
+// name of a header's integrator id, adaptive ones included
+const char *trajIntegratorName(int integrator);
+
+class TrajectoryWriter
+{
+public:
+    TrajectoryWriter();
+    ~TrajectoryWriter();
+    bool open(const char *path, const TrajHeader &header);
+    void append(const Body &body, double time);
+    void close();
+    bool isOpen() const { return file.is_open(); }
+
+private:
+    void flush();
+
+    std::ofstream file;
+    TrajHeader header;
+    std::vector<TrajRecord> pending;
+};
+
+// Read-only view of a trajectory file through a memory mapping; records are
+// never copied, and neither is the reader, which owns the mapping.
+class TrajectoryReader
+{
+public:
+    TrajectoryReader();
+    ~TrajectoryReader();
+    TrajectoryReader(const TrajectoryReader&) = delete;
+    TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+    bool open(const char *path);
+    void close();
+    const TrajHeader &getHeader() const { return *header; }
+    uint64_t size() const { return count; }
+    const TrajRecord &operator[](uint64_t i) const
+    {
+        return *reinterpret_cast<const TrajRecord*>(base + header->headerSize + i*header->recordSize);
+    }
+    // index of the last record with time <= t, or 0
+    uint64_t findTime(double t) const;
+
+private:
+    const unsigned char *base;
+    const TrajHeader *header;
+    uint64_t length;
+    uint64_t count;
+#ifdef _WIN32
+    void *fileHandle;
+    void *mappingHandle;
+#else
+    int fd;
+#endif
+};
+
+#endif // TRAJECTORY_H
@@ -0,0 +1,178 @@
+#include "transforms.hpp"
+
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+
+const char *cameraShaderSource =
+    "layout(std140) uniform Camera {"
+    "  mat4 view;"
+    "  mat4 proj;"
+    "};";
+
+// glm matrices are column-major, so texel k of an object is column k
+const char *objectShaderSource =
+    "uniform samplerBuffer objects;"
+    "uniform int objectBase;"
+    "mat4 objectModel() {"
+    "  int i = 4 * (objectBase + gl_InstanceID);"
+    "  return mat4( texelFetch(objects, i), texelFetch(objects, i + 1),"
+    "               texelFetch(objects, i + 2), texelFetch(objects, i + 3) );"
+    "}";
+
+CameraBlock::CameraBlock()
+{
+    isInited = false;
+    camera_ubo = 0;
+}
+
+CameraBlock::~CameraBlock()
+{
+
+}
+
+void CameraBlock::init()
+{
+    if (isInited) {
+        cleanup();
+    }
+
+    glGenBuffers(1, &camera_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, camera_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, camera_ubo);
+
+    isInited = true;
+}
+
+void CameraBlock::cleanup()
+{
+    if (!isInited) {
+        return;
+    }
+    if (camera_ubo) {
+        glDeleteBuffers(1, &camera_ubo);
+    }
+
+    isInited = false;
+    camera_ubo = 0;
+}
+
+void CameraBlock::attach(GLuint program) const
+{
+    GLuint block = glGetUniformBlockIndex(program, "Camera");
+    if (block == GL_INVALID_INDEX) {
+        std::cout << "program has no Camera block" << std::endl;
+        return;
+    }
+    glUniformBlockBinding(program, block, CAMERA_BLOCK_BINDING);
+}
+
+void CameraBlock::update(const glm::mat4 &view, const glm::mat4 &proj)
+{
+    // std140 lays out two mat4 as 32 consecutive floats, same as glm
+    glm::mat4 camera[2] = { view, proj };
+    glBindBuffer(GL_UNIFORM_BUFFER, camera_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(camera), camera);
+}
+
+ObjectTransforms::ObjectTransforms()
+{
+    isInited = false;
+    objects_tbo = 0;
+    objects_texture = 0;
+    unit = 0;
+    maxObjects = 0;
+}
+
+ObjectTransforms::~ObjectTransforms()
+{
+
+}
+
+void ObjectTransforms::init(int objects, int textureUnit)
+{
+    if (isInited) {
+        cleanup();
+    }
+
+    glGenBuffers(1, &objects_tbo);
+    glBindBuffer(GL_TEXTURE_BUFFER, objects_tbo);
+    glBufferData(GL_TEXTURE_BUFFER, objects * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+
+    glGenTextures(1, &objects_texture);
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, objects_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, objects_tbo);
+
+    unit = textureUnit;
+    maxObjects = objects;
+    models.reserve(objects);
+    models.clear();
+
+    isInited = true;
+}
+
+void ObjectTransforms::cleanup()
+{
+    if (!isInited) {
+        return;
+    }
+    if (objects_texture) {
+        glDeleteTextures(1, &objects_texture);
+    }
+    if (objects_tbo) {
+        glDeleteBuffers(1, &objects_tbo);
+    }
+
+    isInited = false;
+    objects_tbo = 0;
+    objects_texture = 0;
+    models.clear();
+}
+
+GLint ObjectTransforms::attach(GLuint program) const
+{
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "objects"), unit);
+    return glGetUniformLocation(program, "objectBase");
+}
+
+void ObjectTransforms::clear()
+{
+    models.clear();
+}
+
+int ObjectTransforms::add(const glm::mat4 &model)
+{
+    if ((int)models.size() >= maxObjects) {
+        return -1;
+    }
+    models.push_back(model);
+    return (int)models.size() - 1;
+}
+
+int ObjectTransforms::add(const glm::vec3 &translation)
+{
+    return add(glm::translate(glm::mat4(1.0f), translation));
+}
+
+void ObjectTransforms::upload()
+{
+    if (!isInited) {
+        std::cout << "please call init() before upload()" << std::endl;
+        return;
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, objects_tbo);
+    // orphan last frame's storage so the upload never waits on the GPU
+    glBufferData(GL_TEXTURE_BUFFER, maxObjects * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+    if (!models.empty()) {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, models.size() * sizeof(glm::mat4), &models[0]);
+    }
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_BUFFER, objects_texture);
+}
+
+int ObjectTransforms::size() const
+{
+    return (int)models.size();
+}
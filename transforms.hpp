@@ -0,0 +1,71 @@
+#ifndef TRANSFORMS_H
+#define TRANSFORMS_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+// binding point of the Camera uniform block in every program
+#define CAMERA_BLOCK_BINDING 0
+
+// GLSL declarations for the vertex shaders, placed after the #version line:
+// cameraShaderSource declares the Camera block (view, proj), and
+// objectShaderSource the object buffer and objectModel(), which returns the
+// model matrix of object objectBase + gl_InstanceID.
+extern const char *cameraShaderSource;
+extern const char *objectShaderSource;
+
+// view and proj shared by every program through one std140 uniform block.
+// update() sends both with a single upload; call it once per frame so a
+// resized window is picked up without touching the programs.
+class CameraBlock
+{
+public:
+    CameraBlock();
+    ~CameraBlock();
+    void init();
+    void cleanup();
+    // points the program's Camera block at the shared binding
+    void attach(GLuint program) const;
+    void update(const glm::mat4 &view, const glm::mat4 &proj);
+
+private:
+    bool isInited;
+    GLuint camera_ubo;
+};
+
+// Model matrices of everything drawn in a frame, packed into one buffer and
+// read by the vertex shader through a buffer texture, four RGBA32F texels per
+// matrix. Objects are added while the frame is built and upload() sends them
+// all at once, so a draw only sets objectBase, and an instanced draw of n
+// objects added one after the other covers all of them. GL 4.1 has neither
+// storage buffers nor gl_DrawID, hence the buffer texture and gl_InstanceID.
+class ObjectTransforms
+{
+public:
+    ObjectTransforms();
+    ~ObjectTransforms();
+    // the buffer texture is bound to texture unit textureUnit
+    void init(int maxObjects, int textureUnit = 0);
+    void cleanup();
+    // sets the program's sampler to our texture unit and returns the
+    // location of its objectBase uniform
+    GLint attach(GLuint program) const;
+    // starts a new frame
+    void clear();
+    // returns the index to pass as objectBase, or -1 when the buffer is full
+    int add(const glm::mat4 &model);
+    int add(const glm::vec3 &translation);
+    // sends this frame's matrices in one call and binds the texture
+    void upload();
+    int size() const;
+
+private:
+    bool isInited;
+    GLuint objects_tbo, objects_texture;
+    int unit;
+    int maxObjects;
+    std::vector<glm::mat4> models;
+};
+
+#endif // TRANSFORMS_H
@@ -0,0 +1,52 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+// Lock-free handoff of the latest value from one writer thread to one reader
+// thread. Three slots: the writer fills its back slot and publish() swaps it
+// with the middle one; the reader's update() swaps its front slot with the
+// middle one if something new was published since. Neither side ever waits,
+// and the reader always sees a complete value, skipping any it was too slow
+// to see. The slots are reused, so a T holding vectors sized once up front
+// is handed over without allocating.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : middle(1), back(0), front(2) {}
+
+    // for sizing the slots before the threads start
+    T &slot(int i) { return slots[i]; }
+
+    // writer side
+    T &writeBuffer() { return slots[back]; }
+    void publish()
+    {
+        back = middle.exchange(back | fresh, std::memory_order_acq_rel) & indexMask;
+    }
+
+    // reader side; returns false if nothing was published since the last call
+    bool update()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & fresh)) {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+    const T &readBuffer() const { return slots[front]; }
+
+private:
+    static const int indexMask = 3;
+    static const int fresh = 4;
+
+    T slots[3];
+    // index of the middle slot, plus fresh when the writer put it there;
+    // each side's own index on its own cache line
+    alignas(64) std::atomic<int> middle;
+    alignas(64) int back;
+    alignas(64) int front;
+};
+
+#endif // TRIPLEBUFFER_H